@@ -24,6 +24,7 @@
 #include "libsemigroups/bitset.hpp"        // for BitSet
 #include "libsemigroups/bmat.hpp"          // for BMat adapters
 #include "libsemigroups/froidure-pin.hpp"  // for FroidurePin
+#include "libsemigroups/konieczny.hpp"     // for Konieczny
 #include "libsemigroups/matrix.hpp"        // for BMat
 #include "libsemigroups/report.hpp"        // for ReportGuard
 #include "libsemigroups/transf.hpp"        // for Transformation
@@ -1082,4 +1083,31 @@ namespace libsemigroups {
     benchmark_transf_lambda<BitSet<64>>(S, "Lambda<Transf>, BitSet<64>");
   }
 
+  // The frames of the D-classes are stored in an arena (see
+  // Konieczny::FrameArena), which only avoids one allocation per element
+  // when the element type is stored by pointer and holds its data inline,
+  // such as LeastTransf<16>. Elements of Transf<> still own a
+  // std::vector each, and so this compares the two.
+  TEST_CASE("Example 5: Konieczny, LeastTransf<16> vs Transf<>",
+            "[quick][030][transf]") {
+    auto rg = ReportGuard(false);
+
+    BENCHMARK("LeastTransf<16>") {
+      using Transf = LeastTransf<16>;
+      Konieczny<Transf> S(
+          {Transf({5, 11, 12, 8, 15, 9, 11, 5, 15, 0, 0, 1, 12, 7, 13, 12}),
+           Transf({6, 9, 2, 4, 14, 5, 2, 4, 11, 12, 10, 12, 13, 14, 2, 4})});
+      REQUIRE(S.size() == 114071);
+      REQUIRE(S.number_of_D_classes() == 5796);
+    };
+
+    BENCHMARK("Transf<>") {
+      Konieczny<Transf<>> S(
+          {Transf<>({5, 11, 12, 8, 15, 9, 11, 5, 15, 0, 0, 1, 12, 7, 13, 12}),
+           Transf<>({6, 9, 2, 4, 14, 5, 2, 4, 11, 12, 10, 12, 13, 14, 2, 4})});
+      REQUIRE(S.size() == 114071);
+      REQUIRE(S.number_of_D_classes() == 5796);
+    };
+  }
+
 }  // namespace libsemigroups
@@ -54,6 +54,20 @@ namespace libsemigroups {
     void after_normal_forms(S* tc) {
       delete tc;
     }
+
+    using strategy = congruence::ToddCoxeter::options::strategy;
+
+    template <strategy val>
+    fpsemigroup::ToddCoxeter* before_strategy(FpSemiIntfArgs const& p) {
+      auto tc = make<fpsemigroup::ToddCoxeter>(p);
+      tc->congruence().strategy(val).random_interval(
+          std::chrono::milliseconds(10));
+      return tc;
+    }
+
+    void bench_strategy(fpsemigroup::ToddCoxeter* tc, size_t) {
+      tc->run();
+    }
   }  // namespace
 
   //     std::vector<FpSemiIntfArgs> subset =
@@ -73,4 +87,18 @@ namespace libsemigroups {
                           after_normal_forms<fpsemigroup::ToddCoxeter>,
                           fpsemigroup::finite_examples());
 
+  LIBSEMIGROUPS_BENCHMARK("Random strategy ToddCoxeter",
+                          "[ToddCoxeter][strategy][random][003]",
+                          before_strategy<strategy::random>,
+                          bench_strategy,
+                          after_normal_forms<fpsemigroup::ToddCoxeter>,
+                          fpsemigroup::finite_examples());
+
+  LIBSEMIGROUPS_BENCHMARK("Adaptive strategy ToddCoxeter",
+                          "[ToddCoxeter][strategy][adaptive][004]",
+                          before_strategy<strategy::adaptive>,
+                          bench_strategy,
+                          after_normal_forms<fpsemigroup::ToddCoxeter>,
+                          fpsemigroup::finite_examples());
+
 }  // namespace libsemigroups
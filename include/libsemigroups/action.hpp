@@ -22,10 +22,15 @@
 #ifndef LIBSEMIGROUPS_ACTION_HPP_
 #define LIBSEMIGROUPS_ACTION_HPP_
 
-#include <cstddef>        // for size_t
-#include <type_traits>    // for is_trivially_default_construc...
-#include <unordered_map>  // for unordered_map
-#include <vector>         // for vector
+#include <algorithm>    // for min
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <exception>    // for exception_ptr, rethrow_exception
+#include <functional>   // for ref
+#include <thread>       // for thread
+#include <type_traits>  // for is_trivially_default_construc...
+#include <utility>      // for pair
+#include <vector>       // for vector
 
 #include "adapters.hpp"          // for One
 #include "bruidhinn-traits.hpp"  // for detail::BruidhinnTraits
@@ -48,6 +53,22 @@ namespace libsemigroups {
     right
   };
 
+  namespace detail {
+    // Points of a trivially copyable type, such as BitSet<N>,
+    // StaticVector1<T, N>, or PPerm<N>, have a fixed size, and are stored by
+    // value, and hence contiguously, in an Action. Points of any other type
+    // are stored as described by BruidhinnTraits.
+    template <typename TPointType, typename = void>
+    struct ActionPointTraits : BruidhinnTraits<TPointType> {};
+
+    template <typename TPointType>
+    struct ActionPointTraits<
+        TPointType,
+        std::enable_if_t<std::is_trivially_copyable<TPointType>::value
+                         && !std::is_pointer<TPointType>::value>>
+        : BruidhinnValueTraits<TPointType> {};
+  }  // namespace detail
+
   //! Defined in ``action.hpp``.
   //!
   //! This page contains details of the Action class in ``libsemigroups`` for
@@ -63,6 +84,14 @@ namespace libsemigroups {
   //! that can be obtained by acting on the seeds of \c this by the generators
   //! of \c this until no further points can be found, or \c stopped
   //! returns \c true.  This is achieved by performing a breadth first search.
+  //! If max_threads() is greater than \c 1, then the images of the points in
+  //! the search are computed by several threads, but the points are numbered
+  //! exactly as they would be by a single thread.
+  //!
+  //! Points of a trivially copyable type (such as BitSet<N> or PPerm<N>) are
+  //! stored contiguously, and so references to such points, returned by, for
+  //! example, \c at or \c operator[], are invalidated when \c run finds
+  //! further points.
   //!
   //! \tparam TElementType the type of the elements of the semigroup.
   //!
@@ -118,33 +147,15 @@ namespace libsemigroups {
             typename TActionType,
             typename TTraits,
             side TLeftOrRight>
-  class Action : public Runner, private detail::BruidhinnTraits<TPointType> {
+  class Action : public Runner, private detail::ActionPointTraits<TPointType> {
     ////////////////////////////////////////////////////////////////////////
     // Action - typedefs - private
     ////////////////////////////////////////////////////////////////////////
 
     using internal_point_type =
-        typename detail::BruidhinnTraits<TPointType>::internal_value_type;
-    using internal_const_point_type =
-        typename detail::BruidhinnTraits<TPointType>::internal_const_value_type;
-    using internal_const_reference =
-        typename detail::BruidhinnTraits<TPointType>::internal_const_reference;
-
-    struct InternalEqualTo : private detail::BruidhinnTraits<TPointType> {
-      using EqualTo = typename TTraits::EqualTo;
-      bool operator()(internal_const_point_type x,
-                      internal_const_point_type y) const {
-        return EqualTo()(this->to_external_const(x),
-                         this->to_external_const(y));
-      }
-    };
-
-    struct InternalHash : private detail::BruidhinnTraits<TPointType> {
-      using Hash = typename TTraits::Hash;
-      size_t operator()(internal_const_point_type x) const {
-        return Hash()(this->to_external_const(x));
-      }
-    };
+        typename detail::ActionPointTraits<TPointType>::internal_value_type;
+    using internal_const_point_type = typename detail::ActionPointTraits<
+        TPointType>::internal_const_value_type;
 
     static_assert(
         std::is_const<internal_const_point_type>::value
@@ -169,11 +180,11 @@ namespace libsemigroups {
 
     //! The type of a const reference to a \ref point_type.
     using const_reference_point_type =
-        typename detail::BruidhinnTraits<TPointType>::const_reference;
+        typename detail::ActionPointTraits<TPointType>::const_reference;
 
     //! The type of a const pointer to a \ref point_type.
     using const_pointer_point_type =
-        typename detail::BruidhinnTraits<TPointType>::const_pointer;
+        typename detail::ActionPointTraits<TPointType>::const_pointer;
 
     //! The type of the index of a point.
     using index_type = size_t;
@@ -206,9 +217,11 @@ namespace libsemigroups {
         = ActionDigraph<size_t>::const_iterator_scc_roots;
 
     //! The type of a const iterator pointing to a \ref point_type.
-    using const_iterator
-        = detail::BruidhinnConstIterator<point_type,
-                                         std::vector<internal_point_type>>;
+    using const_iterator = std::conditional_t<
+        std::is_same<internal_point_type, point_type>::value,
+        typename std::vector<internal_point_type>::const_iterator,
+        detail::BruidhinnConstIterator<point_type,
+                                       std::vector<internal_point_type>>>;
 
    private:
     ////////////////////////////////////////////////////////////////////////
@@ -216,6 +229,8 @@ namespace libsemigroups {
     ////////////////////////////////////////////////////////////////////////
 
     using ActionOp = TActionType;
+    using EqualTo  = typename TTraits::EqualTo;
+    using Hash     = typename TTraits::Hash;
     using One      = typename TTraits::One;
     using Product  = typename TTraits::Product;
     using Swap     = typename TTraits::Swap;
@@ -223,6 +238,9 @@ namespace libsemigroups {
     static_assert(std::is_trivially_default_constructible<ActionOp>::value,
                   "the third template parameter TActionType is not trivially "
                   "default constructible");
+
+    // The number of points processed at a time by run_impl_concurrently
+    static constexpr size_t BLOCK_SIZE = 16384;
     // TODO(later) more static assertions
 
     ////////////////////////////////////////////////////////////////////////
@@ -266,7 +284,7 @@ namespace libsemigroups {
     Action()
         : _gens(),
           _graph(),
-          _map(),
+          _index(),
           _options(),
           _orb(),
           _pos(0),
@@ -313,7 +331,7 @@ namespace libsemigroups {
     //! At most linear in the size() of the Action.
     void reserve(size_t val) {
       _graph.reserve(val, _gens.size());
-      _map.reserve(val);
+      _index.reserve(val);
       _orb.reserve(val);
     }
 
@@ -338,7 +356,7 @@ namespace libsemigroups {
         _tmp_point_init = true;
         _tmp_point      = this->internal_copy(internal_seed);
       }
-      _map.emplace(internal_seed, _orb.size());
+      _index.insert(Hash()(seed), _orb.size());
       _orb.push_back(internal_seed);
       _graph.add_nodes(1);
     }
@@ -377,12 +395,7 @@ namespace libsemigroups {
     //! \complexity
     //! Constant.
     index_type position(const_reference_point_type pt) const {
-      auto it = _map.find(this->to_internal_const(pt));
-      if (it != _map.end()) {
-        return (*it).second;
-      } else {
-        return UNDEFINED;
-      }
+      return find_point(pt, Hash()(pt));
     }
 
     //! Checks if the Action contains any points.
@@ -415,6 +428,9 @@ namespace libsemigroups {
     //!
     //! \complexity
     //! Constant.
+    //!
+    //! \warning If the points are of a trivially copyable type, then the
+    //! returned reference is invalidated when \c run finds further points.
     inline const_reference_point_type operator[](size_t pos) const noexcept {
       LIBSEMIGROUPS_ASSERT(pos < _orb.size());
       return this->to_external_const(_orb[pos]);
@@ -433,6 +449,9 @@ namespace libsemigroups {
     //!
     //! \complexity
     //! Constant.
+    //!
+    //! \warning If the points are of a trivially copyable type, then the
+    //! returned reference is invalidated when \c run finds further points.
     inline const_reference_point_type at(size_t pos) const {
       return this->to_external_const(_orb.at(pos));
     }
@@ -508,6 +527,54 @@ namespace libsemigroups {
       return const_iterator(_orb.cend());
     }
 
+    ////////////////////////////////////////////////////////////////////////
+    // Action - settings - public
+    ////////////////////////////////////////////////////////////////////////
+
+    //! Set the maximum number of threads used by \c run.
+    //!
+    //! If \p val is greater than \c 1, then the points found so far are
+    //! processed in blocks: the images of the points in a block under the
+    //! generators are computed, and looked up among the known points, by up
+    //! to \p val threads, and then the new points are added by the calling
+    //! thread in the same order as they are added when \p val is \c 1.
+    //! Hence the points, their indices, and the digraph() do not depend on
+    //! \p val. The call operator of \ref action_type and the adapters in
+    //! the traits class may be called from more than one thread, and if any
+    //! of these throws an exception, then it is rethrown by \c run once
+    //! every thread has finished. The predicate passed to \c run_until, and
+    //! any other request to stop, is only checked once every block of
+    //! 16384 points, by the calling thread.
+    //!
+    //! The default value is \c 1, and a value of \c 0 is treated as \c 1.
+    //!
+    //! \param val the maximum number of threads to use.
+    //!
+    //! \returns A reference to `*this`.
+    //!
+    //! \exceptions
+    //! \noexcept
+    Action& max_threads(size_t val) noexcept {
+      _options._max_threads = (val == 0 ? 1 : val);
+      return *this;
+    }
+
+    //! The current maximum number of threads.
+    //!
+    //! \returns
+    //! A value of type \c size_t.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \par Parameters
+    //! (None)
+    //!
+    //! \sa max_threads(size_t).
+    size_t max_threads() const noexcept {
+      return _options._max_threads;
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // Action - member functions: strongly connected components - public
     ////////////////////////////////////////////////////////////////////////
@@ -697,6 +764,10 @@ namespace libsemigroups {
     //!
     //! \throws LibsemigroupsException if the point \p x does not belong to
     //! the action.
+    //!
+    //! \warning If the points are of a trivially copyable type, then the
+    //! returned reference is invalidated if further points are found, for
+    //! example, after a generator or seed is added.
     const_reference_point_type root_of_scc(const_reference_point_type x) {
       return this->to_external_const(_orb[_graph.root_of_scc(position(x))]);
     }
@@ -715,6 +786,10 @@ namespace libsemigroups {
     //! enumerated orbit.
     //!
     //! \throws LibsemigroupsException if the index \p pos is out of range.
+    //!
+    //! \warning If the points are of a trivially copyable type, then the
+    //! returned reference is invalidated if further points are found, for
+    //! example, after a generator or seed is added.
     const_reference_point_type root_of_scc(index_type pos) {
       return this->to_external_const(_orb[_graph.root_of_scc(pos)]);
     }
@@ -757,32 +832,42 @@ namespace libsemigroups {
             ActionOp()(this->to_external(_tmp_point),
                        this->to_external_const(_orb[i]),
                        _gens[j]);
-            auto it = _map.find(_tmp_point);
-            if (it == _map.end()) {
+            size_t const hash = Hash()(this->to_external_const(_tmp_point));
+            size_t const pos
+                = find_point(this->to_external_const(_tmp_point), hash);
+            if (pos == UNDEFINED) {
               _graph.add_nodes(1);
               _graph.add_edge(i, _orb.size(), j);
+              _index.insert(hash, _orb.size());
               _orb.push_back(this->internal_copy(_tmp_point));
-              _map.emplace(_orb.back(), _orb.size() - 1);
             } else {
-              _graph.add_edge(i, (*it).second, j);
+              _graph.add_edge(i, pos, j);
             }
           }
         }
       }
 
+      if (max_threads() > 1) {
+        run_impl_concurrently();
+        report_why_we_stopped();
+        return;
+      }
+
       for (; _pos < _orb.size() && !stopped(); ++_pos) {
         for (size_t j = 0; j < _gens.size(); ++j) {
           ActionOp()(this->to_external(_tmp_point),
                      this->to_external_const(_orb[_pos]),
                      _gens[j]);
-          auto it = _map.find(_tmp_point);
-          if (it == _map.end()) {
+          size_t const hash = Hash()(this->to_external_const(_tmp_point));
+          size_t const pos
+              = find_point(this->to_external_const(_tmp_point), hash);
+          if (pos == UNDEFINED) {
             _graph.add_nodes(1);
             _graph.add_edge(_pos, _orb.size(), j);
+            _index.insert(hash, _orb.size());
             _orb.push_back(this->internal_copy(_tmp_point));
-            _map.emplace(_orb.back(), _orb.size() - 1);
           } else {
-            _graph.add_edge(_pos, (*it).second, j);
+            _graph.add_edge(_pos, pos, j);
           }
         }
         if (report()) {
@@ -792,6 +877,122 @@ namespace libsemigroups {
       report_why_we_stopped();
     }
 
+    // The images of the points in [_pos, _pos + n) under the generators are
+    // computed, and looked up in _index, by several threads, which do not
+    // modify _index, _orb, or _graph. The images not already in _index are
+    // then added by this thread in the order of the loop in run_impl, and so
+    // the points are numbered as they are when max_threads() is 1.
+    void run_impl_concurrently() {
+      // The index of an image in _orb, or UNDEFINED and a copy of the image.
+      struct Image {
+        size_t              index;
+        size_t              hash;
+        internal_point_type point;
+      };
+      size_t const nr_gens = _gens.size();
+      // The entry for the image of the i-th point of a block under the j-th
+      // generator is images[i * nr_gens + j].
+      std::vector<Image> images;
+
+      // The worker computing the images of the points in [first, last) sets
+      // done to the number of entries of images that it has filled in, and
+      // error to any exception thrown, which is rethrown by this thread.
+      auto worker = [this, &images, nr_gens](size_t              first,
+                                             size_t              last,
+                                             size_t&             done,
+                                             std::exception_ptr& error) {
+        internal_point_type tmp = this->internal_copy(_tmp_point);
+        try {
+          for (size_t i = first; i < last; ++i) {
+            for (size_t j = 0; j < nr_gens; ++j) {
+              ActionOp()(this->to_external(tmp),
+                         this->to_external_const(_orb[_pos + i]),
+                         _gens[j]);
+              auto& image = images[i * nr_gens + j];
+              image.hash  = Hash()(this->to_external_const(tmp));
+              image.index
+                  = find_point(this->to_external_const(tmp), image.hash);
+              if (image.index == UNDEFINED) {
+                image.point = this->internal_copy(tmp);
+              }
+              ++done;
+            }
+          }
+        } catch (...) {
+          error = std::current_exception();
+        }
+        this->internal_free(tmp);
+      };
+
+      while (_pos < _orb.size() && !stopped()) {
+        size_t const n = std::min(_orb.size() - _pos, BLOCK_SIZE);
+        size_t const nr_threads = std::min(max_threads(), n);
+        images.resize(n * nr_gens);
+        std::vector<size_t>             first(nr_threads + 1, 0);
+        std::vector<size_t>             done(nr_threads, 0);
+        std::vector<std::exception_ptr> error(nr_threads);
+        for (size_t t = 0; t < nr_threads; ++t) {
+          first[t + 1]
+              = first[t] + n / nr_threads + (t < n % nr_threads ? 1 : 0);
+        }
+        if (nr_threads == 1) {
+          worker(0, n, done[0], error[0]);
+        } else {
+          std::vector<std::thread> threads;
+          for (size_t t = 0; t < nr_threads; ++t) {
+            threads.emplace_back(worker,
+                                 first[t],
+                                 first[t + 1],
+                                 std::ref(done[t]),
+                                 std::ref(error[t]));
+          }
+          for (auto& thread : threads) {
+            thread.join();
+          }
+        }
+        for (size_t t = 0; t < nr_threads; ++t) {
+          if (error[t] != nullptr) {
+            // Nothing was added in this block, and so the copies of the
+            // images are freed and the block can be run again.
+            for (size_t s = 0; s < nr_threads; ++s) {
+              for (size_t k = first[s] * nr_gens;
+                   k < first[s] * nr_gens + done[s];
+                   ++k) {
+                if (images[k].index == UNDEFINED) {
+                  this->internal_free(images[k].point);
+                }
+              }
+            }
+            std::rethrow_exception(error[t]);
+          }
+        }
+
+        for (size_t i = 0; i < n; ++i, ++_pos) {
+          for (size_t j = 0; j < nr_gens; ++j) {
+            auto& image = images[i * nr_gens + j];
+            if (image.index == UNDEFINED) {
+              // The image was not known at the start of the block, but may
+              // have been added since.
+              image.index = find_point(this->to_external_const(image.point),
+                                       image.hash);
+              if (image.index == UNDEFINED) {
+                _graph.add_nodes(1);
+                _graph.add_edge(_pos, _orb.size(), j);
+                _index.insert(image.hash, _orb.size());
+                _orb.push_back(image.point);
+                continue;
+              }
+              this->internal_free(image.point);
+            }
+            _graph.add_edge(_pos, image.index, j);
+          }
+        }
+        if (report()) {
+          REPORT_DEFAULT("found %d points, so far\n", _orb.size());
+        }
+      }
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // Action - member functions - private
     ////////////////////////////////////////////////////////////////////////
@@ -805,6 +1006,12 @@ namespace libsemigroups {
       }
     }
 
+    index_type find_point(const_reference_point_type pt, size_t hash) const {
+      return _index.find(hash, [this, &pt](index_type i) {
+        return EqualTo()(this->to_external_const(_orb[i]), pt);
+      });
+    }
+
     void validate_gens() const {
       if (_gens.empty()) {
         LIBSEMIGROUPS_EXCEPTION("no generators defined, this methods cannot be "
@@ -836,25 +1043,108 @@ namespace libsemigroups {
      private:
       std::vector<std::pair<bool, element_type>> _multipliers;
     };
+
+    // An open addressing hash table, with linear probing, of the indices of
+    // the points in _orb. The hash value of every point is stored alongside
+    // its index, and so points are only compared (by the callback passed to
+    // find) if their hash values coincide.
+    class PointIndex {
+     public:
+      PointIndex() : _shift(64), _size(0), _slots() {}
+
+      template <typename TEqualTo>
+      index_type find(size_t hash, TEqualTo&& equal_to) const {
+        if (_slots.empty()) {
+          return UNDEFINED;
+        }
+        size_t const mask = _slots.size() - 1;
+        for (size_t i = first_slot(hash);; i = (i + 1) & mask) {
+          Slot const& slot = _slots[i];
+          if (slot.index == UNDEFINED) {
+            return UNDEFINED;
+          } else if (slot.hash == hash && equal_to(slot.index)) {
+            return slot.index;
+          }
+        }
+      }
+
+      // Does not check if there is already an index with hash value hash.
+      void insert(size_t hash, index_type index) {
+        if (4 * (_size + 1) > 3 * _slots.size()) {
+          rehash(std::max(size_t(16), 2 * _slots.size()));
+        }
+        insert_no_rehash(hash, index);
+        _size++;
+      }
+
+      void reserve(size_t val) {
+        size_t nr_slots = std::max(size_t(16), _slots.size());
+        while (4 * val > 3 * nr_slots) {
+          nr_slots *= 2;
+        }
+        if (nr_slots > _slots.size()) {
+          rehash(nr_slots);
+        }
+      }
+
+     private:
+      struct Slot {
+        size_t     hash;
+        index_type index;
+      };
+
+      // Fibonacci hashing, so that hash values which only differ in their
+      // high bits are not put in the same slot.
+      size_t first_slot(size_t hash) const noexcept {
+        return (static_cast<uint64_t>(hash) * 11400714819323198485ULL)
+               >> _shift;
+      }
+
+      void insert_no_rehash(size_t hash, index_type index) {
+        size_t const mask = _slots.size() - 1;
+        size_t       i    = first_slot(hash);
+        while (_slots[i].index != UNDEFINED) {
+          i = (i + 1) & mask;
+        }
+        _slots[i] = {hash, index};
+      }
+
+      // nr_slots must be a power of 2
+      void rehash(size_t nr_slots) {
+        std::vector<Slot> old(nr_slots, {0, UNDEFINED});
+        std::swap(old, _slots);
+        _shift = 64;
+        for (size_t n = nr_slots; n > 1; n >>= 1) {
+          _shift--;
+        }
+        for (Slot const& slot : old) {
+          if (slot.index != UNDEFINED) {
+            insert_no_rehash(slot.hash, slot.index);
+          }
+        }
+      }
+
+      size_t            _shift;
+      size_t            _size;
+      std::vector<Slot> _slots;
+    };
+
     ////////////////////////////////////////////////////////////////////////
     // Action - data members - private
     ////////////////////////////////////////////////////////////////////////
 
     std::vector<element_type> _gens;
     ActionDigraph<size_t>     _graph;
-    std::unordered_map<internal_const_point_type,
-                       size_t,
-                       InternalHash,
-                       InternalEqualTo>
-        _map;
+    PointIndex                _index;
     struct Options {
-      Options() : _cache_scc_multipliers(false) {}
+      Options() : _cache_scc_multipliers(false), _max_threads(1) {}
       Options(Options const&) = default;
       Options(Options&&)      = default;
       Options& operator=(Options const&) = default;
       Options& operator=(Options&&) = default;
 
-      bool _cache_scc_multipliers;
+      bool   _cache_scc_multipliers;
+      size_t _max_threads;
     } _options;
     std::vector<internal_point_type> _orb;
     MultiplierCache                  _multipliers_from_scc_root;
@@ -864,6 +1154,15 @@ namespace libsemigroups {
     bool                             _tmp_point_init;
   };
 
+  template <typename TElementType,
+            typename TPointType,
+            typename TActionType,
+            typename TTraits,
+            side TLeftOrRight>
+  constexpr size_t
+      Action<TElementType, TPointType, TActionType, TTraits, TLeftOrRight>::
+          BLOCK_SIZE;
+
   //! This is a traits class for use with Action, \ref LeftAction,
   //! and \ref RightAction.
   //!
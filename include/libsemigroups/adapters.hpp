@@ -767,5 +767,36 @@ namespace libsemigroups {
             typename TStateType = RankState<TElementType>,
             typename            = void>
   struct Rank;
+
+  //! Adapter for representing group \f$\mathscr{H}\f$-classes by
+  //! permutations.
+  //!
+  //! Defined in ``adapters.hpp``.
+  //!
+  //! Specialisations of this class should have a static constexpr member \c
+  //! degree of type \c size_t, a typedef \c type for permutations of degree
+  //! \c degree (suitable for use as the element type of SchreierSims), and a
+  //! call operator of signature `void operator()(type&, TElementType const&
+  //! e, TElementType const& x)` which, if \c e is an idempotent and \c x
+  //! belongs to the \f$\mathscr{H}\f$-class of \c e, modifies the first
+  //! argument in-place to be the permutation corresponding to \c x. The map
+  //! from the \f$\mathscr{H}\f$-class of \c e to permutations must be an
+  //! injective homomorphism.
+  //!
+  //! The default declaration provided here has \c degree equal to \c 0 and
+  //! indicates that there is no such representation for \c TElementType.
+  //!
+  //! \tparam TElementType the type of elements.
+  //!
+  //! The second template parameter exists for SFINAE.
+  //!
+  //! \par Used by:
+  //! * KoniecznyTraits.
+  template <typename TElementType, typename = void>
+  struct GroupHClassPerm {
+    //! There are no permutations representing the group
+    //! \f$\mathscr{H}\f$-classes by default.
+    static constexpr size_t degree = 0;
+  };
 }  // namespace libsemigroups
 #endif  // LIBSEMIGROUPS_ADAPTERS_HPP_
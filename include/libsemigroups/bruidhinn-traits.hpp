@@ -109,12 +109,11 @@ namespace libsemigroups {
       inline void external_free(value_type) const {}
     };
 
+    // Conveys values by copying them. This is used by BruidhinnTraits for
+    // small trivial types, and by Action for the points of any trivially
+    // copyable type, which it stores contiguously.
     template <typename TValueType>
-    struct BruidhinnTraits<
-        TValueType,
-        std::enable_if_t<std::is_trivial<TValueType>::value
-                         && IsSmall<TValueType>::value
-                         && !std::is_pointer<TValueType>::value>> {
+    struct BruidhinnValueTraits {
       using value_type       = TValueType;
       using const_value_type = TValueType const;
       using reference        = TValueType&;
@@ -128,12 +127,14 @@ namespace libsemigroups {
       using internal_reference        = reference;
       using internal_const_reference  = const_reference;
 
-      BruidhinnTraits() noexcept                       = default;
-      BruidhinnTraits(BruidhinnTraits const&) noexcept = default;
-      BruidhinnTraits(BruidhinnTraits&&) noexcept      = default;
-      BruidhinnTraits& operator=(BruidhinnTraits const&) noexcept = default;
-      BruidhinnTraits& operator=(BruidhinnTraits&&) noexcept = default;
-      ~BruidhinnTraits()                                     = default;
+      BruidhinnValueTraits() noexcept                            = default;
+      BruidhinnValueTraits(BruidhinnValueTraits const&) noexcept = default;
+      BruidhinnValueTraits(BruidhinnValueTraits&&) noexcept      = default;
+      BruidhinnValueTraits& operator=(BruidhinnValueTraits const&) noexcept
+          = default;
+      BruidhinnValueTraits& operator=(BruidhinnValueTraits&&) noexcept
+          = default;
+      ~BruidhinnValueTraits() = default;
 
       inline internal_const_reference
       to_internal_const(const_reference x) const {
@@ -169,6 +170,14 @@ namespace libsemigroups {
       inline void external_free(value_type) const {}
     };
 
+    template <typename TValueType>
+    struct BruidhinnTraits<
+        TValueType,
+        std::enable_if_t<std::is_trivial<TValueType>::value
+                         && IsSmall<TValueType>::value
+                         && !std::is_pointer<TValueType>::value>>
+        : BruidhinnValueTraits<TValueType> {};
+
     template <typename TValueType>
     struct BruidhinnTraits<
         TValueType,
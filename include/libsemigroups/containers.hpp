@@ -19,9 +19,12 @@
 #ifndef LIBSEMIGROUPS_CONTAINERS_HPP_
 #define LIBSEMIGROUPS_CONTAINERS_HPP_
 
+#include <algorithm>    // for none_of
 #include <array>        // for array
 #include <cstddef>      // for size_t
+#include <cstdint>      // for uint32_t
 #include <iterator>     // for reverse_iterator
+#include <memory>       // for shared_ptr
 #include <type_traits>  // for is_default_constructible
 #include <vector>       // for vector, allocator
 
@@ -173,17 +176,24 @@ namespace libsemigroups {
       // TODO(later) 1. make this a non-member function
       //             2. should perform checks that p actually permutes the
       //                given row
+      // The rows are permuted in place by following the cycles of p, and the
+      // rows already in place are recorded in a bitset, rather than a copy
+      // of p.
       // Not noexcept because std::vector::operator[] isn't
-      void apply_row_permutation(std::vector<size_t> p) {
+      void apply_row_permutation(std::vector<size_t> const& p) {
+        std::vector<bool> seen(p.size(), false);
         for (size_t i = 0; i < p.size(); i++) {
+          if (seen[i]) {
+            continue;
+          }
           size_t current = i;
           while (i != p[current]) {
             size_t next = p[current];
             swap_rows(current, next);
-            p[current] = current;
-            current    = next;
+            seen[current] = true;
+            current       = next;
           }
-          p[current] = current;
+          seen[current] = true;
         }
       }
 
@@ -623,6 +633,324 @@ namespace libsemigroups {
       }
     };
 
+    // Template class for 2-dimensional dynamic arrays some of whose rows are
+    // borrowed from another DynamicArray2 (the "shared" array) until they are
+    // first modified, at which point they are copied. Row r of the shared
+    // array is row r + shift of this, and every entry of the shared array is
+    // increased by shift when read. The shared array is kept alive by this
+    // (and by its copies), but it is not copied, and so the entries that it
+    // has when this is constructed must not be modified while any of its
+    // rows are still borrowed, i.e. while has_shared_rows() returns true.
+    // Rows and columns can be added to the shared array, which can be
+    // detected using shared_array_modified. The values in the borrowed rows
+    // can be relabelled (see apply_value_permutation) without copying them,
+    // the relabelling is applied when the values are read.
+    template <typename T>
+    class CopyOnWriteArray2 final {
+     public:
+      using array_type = DynamicArray2<T>;
+
+      // The largest number of rows for which rows can be borrowed, since the
+      // lowest bit of each value in _index is used as a flag.
+      static constexpr size_t MAX_ROWS = size_t(1) << 31;
+
+      // Not noexcept because DynamicArray2::DynamicArray2 can throw.
+      explicit CopyOnWriteArray2(size_t number_of_cols = 0,
+                                 size_t number_of_rows = 0,
+                                 T      default_val    = 0)
+          : _default_val(default_val),
+            _index(),
+            _owned(number_of_cols, number_of_rows, default_val),
+            _shared(nullptr),
+            _shared_cols(0),
+            _shared_rows(0),
+            _shift(0),
+            _relabel() {}
+
+      // Not noexcept because DynamicArray2::DynamicArray2 can throw.
+      CopyOnWriteArray2(std::shared_ptr<array_type const> shared,
+                        size_t                            shift,
+                        T                                 default_val)
+          : _default_val(default_val),
+            _index(),
+            _owned(shared->number_of_cols(), shift, default_val),
+            _shared(std::move(shared)),
+            _shared_cols(_shared->number_of_cols()),
+            _shared_rows(_shared->number_of_rows()),
+            _shift(shift),
+            _relabel() {
+        if (shift + _shared_rows > MAX_ROWS) {
+          // Too many rows to be borrowed, so they are copied instead
+          _owned.add_rows(_shared_rows);
+          for (size_t i = 0; i < _shared_rows; ++i) {
+            for (size_t j = 0; j < _shared_cols; ++j) {
+              _owned.set(shift + i, j, _shared->get(i, j) + shift);
+            }
+          }
+          _shared = nullptr;
+          return;
+        }
+        _index.reserve(shift + _shared_rows);
+        for (size_t i = 0; i < shift; ++i) {
+          _index.push_back(owned_index(i));
+        }
+        for (size_t i = 0; i < _shared_rows; ++i) {
+          _index.push_back(shared_index(i));
+        }
+      }
+
+      CopyOnWriteArray2(CopyOnWriteArray2 const&) = default;
+      CopyOnWriteArray2(CopyOnWriteArray2&&)      = default;
+      CopyOnWriteArray2& operator=(CopyOnWriteArray2 const&) = default;
+      CopyOnWriteArray2& operator=(CopyOnWriteArray2&&) = default;
+
+      ~CopyOnWriteArray2() = default;
+
+      bool has_shared_rows() const noexcept {
+        return _shared != nullptr;
+      }
+
+      // Returns true if rows or columns have been added to the shared array
+      // since this was constructed, in which case unshare should be called.
+      bool shared_array_modified() const noexcept {
+        return _shared != nullptr
+               && (_shared->number_of_rows() != _shared_rows
+                   || _shared->number_of_cols() != _shared_cols);
+      }
+
+      // Not noexcept because DynamicArray2::get isn't
+      inline T get(size_t i, size_t j) const {
+        if (_shared == nullptr) {
+          return _owned.get(i, j);
+        }
+        LIBSEMIGROUPS_ASSERT(i < _index.size());
+        uint32_t const k = _index[i];
+        return (is_shared_index(k) ? shared_get(k >> 1, j)
+                                   : _owned.get(k >> 1, j));
+      }
+
+      // Not noexcept because DynamicArray2::set isn't
+      inline void set(size_t i, size_t j, T val) {
+        if (_shared == nullptr) {
+          _owned.set(i, j, val);
+        } else {
+          _owned.set(copy_row_if_shared(i), j, val);
+        }
+      }
+
+      // Not noexcept because get and set aren't
+      void swap(size_t i, size_t j, size_t k, size_t l) {
+        T const val = get(i, j);
+        set(i, j, get(k, l));
+        set(k, l, val);
+      }
+
+      void swap(CopyOnWriteArray2& that) noexcept {
+        std::swap(_default_val, that._default_val);
+        _index.swap(that._index);
+        _owned.swap(that._owned);
+        _shared.swap(that._shared);
+        std::swap(_shared_cols, that._shared_cols);
+        std::swap(_shared_rows, that._shared_rows);
+        std::swap(_shift, that._shift);
+        _relabel.swap(that._relabel);
+      }
+
+      size_t number_of_rows() const noexcept {
+        return (_shared == nullptr ? _owned.number_of_rows() : _index.size());
+      }
+
+      size_t number_of_cols() const noexcept {
+        return _owned.number_of_cols();
+      }
+
+      // Not noexcept since DynamicArray2::add_rows can throw.
+      void add_rows(size_t nr) {
+        if (_shared != nullptr && _index.size() + nr > MAX_ROWS) {
+          unshare();
+        }
+        if (_shared != nullptr) {
+          size_t const m = _owned.number_of_rows();
+          for (size_t i = m; i < m + nr; ++i) {
+            _index.push_back(owned_index(i));
+          }
+        }
+        _owned.add_rows(nr);
+      }
+
+      // Only the rows [0, n) are retained, and if none of these rows is
+      // borrowed from the shared array, then the shared array is released.
+      // Not noexcept since DynamicArray2::shrink_rows_to can throw.
+      void shrink_rows_to(size_t n) {
+        if (_shared == nullptr) {
+          _owned.shrink_rows_to(n);
+          return;
+        } else if (n >= _index.size()) {
+          return;
+        }
+        _index.resize(n);
+        _index.shrink_to_fit();
+        release_if_unshared();
+      }
+
+      // Row i becomes the row p[i], for every i.
+      // Not noexcept because DynamicArray2::apply_row_permutation isn't
+      void apply_row_permutation(std::vector<size_t> const& p) {
+        if (_shared == nullptr) {
+          _owned.apply_row_permutation(p);
+        } else {
+          LIBSEMIGROUPS_ASSERT(p.size() == _index.size());
+          std::vector<uint32_t> index(p.size());
+          for (size_t i = 0; i < p.size(); ++i) {
+            index[i] = _index[p[i]];
+          }
+          _index.swap(index);
+        }
+      }
+
+      // Every value v in this, other than the default value, is replaced by
+      // q[v]. The borrowed rows are not copied, instead q is composed with
+      // any previous relabelling of them, and applied when they are read.
+      // Not noexcept because DynamicArray2::get and set aren't
+      void apply_value_permutation(std::vector<T> const& q) {
+        // Nothing to do if q is the identity
+        size_t v = 0;
+        if (std::all_of(q.cbegin(), q.cend(), [&v](T const& w) {
+              return w == static_cast<T>(v++);
+            })) {
+          return;
+        }
+        if (_shared == nullptr) {
+          for (size_t i = 0; i < _owned.number_of_rows(); ++i) {
+            apply_value_permutation(i, q);
+          }
+          return;
+        }
+        for (uint32_t const k : _index) {
+          if (!is_shared_index(k)) {
+            apply_value_permutation(k >> 1, q);
+          }
+        }
+        if (_relabel.empty()) {
+          LIBSEMIGROUPS_ASSERT(q.size() >= _shift + _shared_rows);
+          _relabel = q;
+        } else {
+          for (auto& w : _relabel) {
+            if (w != _default_val) {
+              w = q[w];
+            }
+          }
+        }
+      }
+
+      // Returns the number of rows that are borrowed from the shared array.
+      size_t number_of_shared_rows() const noexcept {
+        return std::count_if(_index.cbegin(), _index.cend(), is_shared_index);
+      }
+
+      // Copies every borrowed row, and releases the shared array.
+      // Not noexcept since shrink_rows_to isn't
+      void unshare() {
+        if (_shared != nullptr) {
+          for (size_t i = 0; i < _index.size(); ++i) {
+            copy_row_if_shared(i);
+          }
+          release_if_unshared();
+        }
+      }
+
+      // It is only valid to call this when has_shared_rows() is false.
+      array_type& array() noexcept {
+        LIBSEMIGROUPS_ASSERT(_shared == nullptr);
+        return _owned;
+      }
+
+      array_type const& array() const noexcept {
+        LIBSEMIGROUPS_ASSERT(_shared == nullptr);
+        return _owned;
+      }
+
+     private:
+      // The lowest bit of each value in _index distinguishes rows of _owned
+      // from rows of _shared.
+      static inline uint32_t owned_index(size_t i) noexcept {
+        LIBSEMIGROUPS_ASSERT(i < MAX_ROWS);
+        return static_cast<uint32_t>(i << 1);
+      }
+
+      static inline uint32_t shared_index(size_t i) noexcept {
+        LIBSEMIGROUPS_ASSERT(i < MAX_ROWS);
+        return static_cast<uint32_t>((i << 1) | 1);
+      }
+
+      static inline bool is_shared_index(uint32_t k) noexcept {
+        return k & 1;
+      }
+
+      size_t copy_row_if_shared(size_t i) {
+        LIBSEMIGROUPS_ASSERT(i < _index.size());
+        uint32_t const k = _index[i];
+        if (!is_shared_index(k)) {
+          return k >> 1;
+        }
+        size_t const r = _owned.number_of_rows();
+        _owned.add_rows(1);
+        for (size_t j = 0; j < _owned.number_of_cols(); ++j) {
+          _owned.set(r, j, shared_get(k >> 1, j));
+        }
+        _index[i] = owned_index(r);
+        return r;
+      }
+
+      // Returns the value in row i and column j of the shared array, as it
+      // appears in this.
+      inline T shared_get(size_t i, size_t j) const {
+        T const val = _shared->get(i, j) + _shift;
+        return (_relabel.empty() ? val : _relabel[val]);
+      }
+
+      void apply_value_permutation(size_t i, std::vector<T> const& q) {
+        for (size_t j = 0; j < _owned.number_of_cols(); ++j) {
+          T const val = _owned.get(i, j);
+          if (val != _default_val) {
+            LIBSEMIGROUPS_ASSERT(val < q.size());
+            _owned.set(i, j, q[val]);
+          }
+        }
+      }
+
+      // If no row is borrowed from _shared, then rearrange _owned so that row
+      // i of this is row i of _owned.
+      void release_if_unshared() {
+        if (std::none_of(_index.cbegin(), _index.cend(), is_shared_index)) {
+          array_type owned(_owned.number_of_cols(), _index.size(), _default_val);
+          for (size_t i = 0; i < _index.size(); ++i) {
+            for (size_t j = 0; j < _owned.number_of_cols(); ++j) {
+              owned.set(i, j, _owned.get(_index[i] >> 1, j));
+            }
+          }
+          _owned.swap(owned);
+          _index.clear();
+          _index.shrink_to_fit();
+          _shared = nullptr;
+          _relabel.clear();
+          _relabel.shrink_to_fit();
+        }
+      }
+
+      T                                 _default_val;
+      std::vector<uint32_t>             _index;
+      array_type                        _owned;
+      std::shared_ptr<array_type const> _shared;
+      size_t                            _shared_cols;
+      size_t                            _shared_rows;
+      size_t                            _shift;
+      std::vector<T>                    _relabel;
+    };
+
+    template <typename T>
+    constexpr size_t CopyOnWriteArray2<T>::MAX_ROWS;
+
     // StaticVector1 wraps an array, providing it with some of the syntax of
     // std::vector.
     // TODO(later) add tests specifically targeting this class
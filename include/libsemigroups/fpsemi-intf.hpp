@@ -418,6 +418,29 @@ namespace libsemigroups {
     //! set_identity(std::string const&).
     void set_inverses(std::string const& a);
 
+    //! Check if inverses have been set.
+    //!
+    //! This function returns \c true if inverses have been set and \c false
+    //! if they have not.
+    //!
+    //! \returns
+    //! A value of type \c bool.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \complexity
+    //! Constant.
+    //!
+    //! \sa
+    //! set_inverses(std::string const&).
+    //!
+    //! \parameters
+    //! (None)
+    bool has_inverses() const noexcept {
+      return !_inverses.empty();
+    }
+
     //! Add a rule using two \string const references.
     //!
     //! \param u the left-hand side of the rule being added.
@@ -26,7 +26,7 @@
 #define LIBSEMIGROUPS_KNUTH_BENDIX_HPP_
 
 #include <cstddef>  // for size_t
-#include <iosfwd>   // for string, ostream
+#include <iosfwd>   // for string, ostream, istream
 #include <memory>   // for unique_ptr
 #include <vector>   // for vector
 
@@ -103,6 +103,24 @@ namespace libsemigroups {
           //! \f$d(AB, BC) = max(|AB|, |BC|)\f$
           MAX_AB_BC = 2
         };
+
+        //! Values for specifying the reduction ordering used to orient rules.
+        //!
+        //! The values in this enum determine which side of a rule a
+        //! KnuthBendix instance uses as the left hand side (the greater side
+        //! with respect to the ordering).
+        //!
+        //! \sa order(options::order)
+        enum class order {
+          //! Words are compared using \ref shortlex_compare.
+          shortlex = 0,
+          //! Words are compared by the sum of the weights of their letters
+          //! (see \ref weights), and words of equal weight are compared
+          //! using \ref shortlex_compare.
+          weighted_shortlex = 1,
+          //! Words are compared using \ref recursive_path_compare.
+          recursive = 2
+        };
       };
 
       //! The type of the return value of froidure_pin().
@@ -249,6 +267,33 @@ namespace libsemigroups {
         return *this;
       }
 
+      //! Set the maximum number of threads.
+      //!
+      //! If this value is greater than \c 1, then \ref run considers the
+      //! overlaps of the left hand sides of blocks of rules in parallel
+      //! using (up to) \p val threads. The critical pairs arising from a
+      //! block are rewritten concurrently with respect to the rules present
+      //! when the block was started, and the resulting rules are then added
+      //! to the system, and the system is reduced, in a single thread. The
+      //! rules obtained can differ from those obtained using a single thread,
+      //! and \ref max_rules is only checked after every block.
+      //!
+      //! The default value is \c 1. Values of \c 0 are treated as \c 1.
+      //!
+      //! \param val the maximum number of threads.
+      //!
+      //! \returns
+      //! A reference to \c *this.
+      //!
+      //! \complexity
+      //! Constant.
+      //!
+      //! \sa \ref run.
+      KnuthBendix& max_threads(size_t val) {
+        _settings._max_threads = (val == 0 ? 1 : val);
+        return *this;
+      }
+
       //! Set the overlap policy.
       //!
       //! This function can be used to determine the way that the length
@@ -265,6 +310,153 @@ namespace libsemigroups {
       //! \sa options::overlap.
       KnuthBendix& overlap_policy(options::overlap val);
 
+      //! Set the reduction ordering.
+      //!
+      //! This function can be used to specify the reduction ordering used to
+      //! orient the rules of the system; every rule is rewritten so that its
+      //! left hand side is greater than its right hand side. Some
+      //! presentations only have a finite complete rewriting system (or only
+      //! have a small one) with respect to orderings other than the default
+      //! short-lex ordering.
+      //!
+      //! The default value is options::order::shortlex. If the ordering is
+      //! not options::order::shortlex, then rules are not necessarily length
+      //! reducing, and rewriting is somewhat slower.
+      //!
+      //! \param val the reduction ordering.
+      //!
+      //! \returns
+      //! A reference to \c *this.
+      //!
+      //! \throws LibsemigroupsException if \ref started returns \c true.
+      //!
+      //! \complexity
+      //! At worst the cost of reducing the rules of the system with respect to
+      //! the new ordering.
+      //!
+      //! \sa options::order and \ref weights.
+      KnuthBendix& order(options::order val);
+
+      //! Set the weights of the letters.
+      //!
+      //! This function sets the weights of the letters of the alphabet used
+      //! by the ordering options::order::weighted_shortlex; the weight of the
+      //! letter <tt>alphabet()[i]</tt> is <tt>val[i]</tt>. By default every
+      //! letter has weight \c 1, in which case
+      //! options::order::weighted_shortlex is just the short-lex ordering.
+      //!
+      //! \param val the weights of the letters.
+      //!
+      //! \returns
+      //! A reference to \c *this.
+      //!
+      //! \throws LibsemigroupsException if \ref started returns \c true.
+      //! \throws LibsemigroupsException if the length of \p val is not the
+      //! size of the alphabet, or if any weight is \c 0.
+      //!
+      //! \complexity
+      //! See \ref order.
+      //!
+      //! \sa options::order and \ref order.
+      KnuthBendix& weights(std::vector<size_t> const& val);
+
+      //! Set the length of overlaps whose processing is deferred.
+      //!
+      //! If the length of the overlap of two left hand sides of rules, as
+      //! measured by the \ref overlap_policy, is greater than \p val, then
+      //! the rule arising from the overlap is not added to the system by
+      //! \ref run straight away. It is instead stored, in compact form, in a
+      //! queue of deferred rules, which are only added to the system once
+      //! every overlap of the active rules has been considered. Deferring
+      //! long overlaps can significantly reduce the number of rules that have
+      //! to be kept in memory at any given time. Unlike \ref max_overlap,
+      //! this does not prevent \ref run from producing a confluent system.
+      //!
+      //! The default value is \ref POSITIVE_INFINITY, i.e. no overlaps are
+      //! deferred.
+      //!
+      //! \param val the length above which overlaps are deferred.
+      //!
+      //! \returns
+      //! A reference to \c *this.
+      //!
+      //! \complexity
+      //! Constant.
+      //!
+      //! \sa \ref defer_to_disk, \ref max_stack_depth, and
+      //! \ref number_of_deferred_rules.
+      KnuthBendix& defer_overlap(size_t val) {
+        _settings._defer_overlap = val;
+        return *this;
+      }
+
+      //! Set whether deferred rules are stored in a temporary file.
+      //!
+      //! If \p val is \c true, then the queue of rules deferred because of
+      //! \ref defer_overlap or \ref max_stack_depth is stored in a temporary
+      //! file rather than in memory. The value only takes effect the next time
+      //! that the queue is empty.
+      //!
+      //! The default value is \c false.
+      //!
+      //! \param val whether or not to store deferred rules in a file.
+      //!
+      //! \returns
+      //! A reference to \c *this.
+      //!
+      //! \throws LibsemigroupsException if a temporary file cannot be
+      //! created or written to by \ref run.
+      //!
+      //! \complexity
+      //! Constant.
+      KnuthBendix& defer_to_disk(bool val) {
+        _settings._defer_to_disk = val;
+        return *this;
+      }
+
+      //! Set the maximum number of inactive rules kept for reuse.
+      //!
+      //! Rules that are removed from the system are kept, so that the memory
+      //! they use can be reused by new rules. This function sets the maximum
+      //! number of such rules, and any inactive rules in excess of \p val are
+      //! deleted.
+      //!
+      //! The default value is \ref POSITIVE_INFINITY.
+      //!
+      //! \param val the maximum number of inactive rules.
+      //!
+      //! \returns
+      //! A reference to \c *this.
+      //!
+      //! \complexity
+      //! Linear in the number of inactive rules that are deleted.
+      KnuthBendix& max_inactive_rules(size_t val);
+
+      //! Set the maximum depth of the stack of rules to be processed.
+      //!
+      //! When a rule is added to the system, any rules whose left hand sides
+      //! it reduces are removed from the system, and put on a stack to be
+      //! rewritten and added again. If the stack already contains \p val
+      //! rules, then such rules are instead deferred in the same way as in
+      //! \ref defer_overlap. This also applies to the rules arising from a
+      //! block of overlaps when \ref max_threads is greater than \c 1.
+      //!
+      //! The default value is \ref POSITIVE_INFINITY.
+      //!
+      //! \param val the maximum depth of the stack.
+      //!
+      //! \returns
+      //! A reference to \c *this.
+      //!
+      //! \complexity
+      //! Constant.
+      //!
+      //! \sa \ref defer_overlap and \ref defer_to_disk.
+      KnuthBendix& max_stack_depth(size_t val) {
+        _settings._max_stack_depth = val;
+        return *this;
+      }
+
       //////////////////////////////////////////////////////////////////////////
       // KnuthBendix - member functions for rules and rewriting - public
       //////////////////////////////////////////////////////////////////////////
@@ -285,6 +477,46 @@ namespace libsemigroups {
       //! (None)
       size_t number_of_active_rules() const noexcept;
 
+      //! Returns the current number of deferred rules.
+      //!
+      //! Rules can be deferred by \ref run if \ref defer_overlap or
+      //! \ref max_stack_depth is set; these rules are not active but are
+      //! still consequences of the defining relations. If this value is not
+      //! \c 0, then the system is not confluent.
+      //!
+      //! \returns
+      //! A value of type `size_t`.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \complexity
+      //! Constant.
+      //!
+      //! \parameters
+      //! (None)
+      size_t number_of_deferred_rules() const noexcept;
+
+      //! Returns the number of pairs of rules whose overlaps have been
+      //! considered.
+      //!
+      //! This value is the number of ordered pairs of active rules (including
+      //! a rule paired with itself) whose overlaps have been considered by
+      //! \ref run since \c this was constructed or loaded by \ref load.
+      //!
+      //! \returns
+      //! A value of type `size_t`.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \complexity
+      //! Constant.
+      //!
+      //! \parameters
+      //! (None)
+      size_t number_of_overlaps() const noexcept;
+
       //! Returns a copy of the active rules.
       //!
       //! This member function returns a vector consisting of the pairs of
@@ -534,6 +766,60 @@ namespace libsemigroups {
       //! (None)
       void knuth_bendix_by_overlap_length();
 
+      //! Write the state of a KnuthBendix instance to a stream.
+      //!
+      //! This function writes the settings, the alphabet, the identity and
+      //! inverses (if any), the defining rules, and the current state of the
+      //! rewriting system (the active rules, the rules waiting to be
+      //! processed, and the position of the next rule whose overlaps should
+      //! be considered) to \p os in a binary format. The output can be read by
+      //! \ref load, so that the Knuth-Bendix procedure can be resumed without
+      //! considering again the overlaps that were already considered.
+      //!
+      //! \param os the stream to write to (which should be opened in binary
+      //! mode).
+      //!
+      //! \returns
+      //! (None)
+      //!
+      //! \exceptions
+      //! \no_libsemigroups_except
+      //!
+      //! \complexity
+      //! Linear in the total length of the rules.
+      //!
+      //! \warning This function should not be called while \ref run is being
+      //! called in another thread.
+      //!
+      //! \sa \ref load.
+      void save(std::ostream& os) const;
+
+      //! Read the state of a KnuthBendix instance from a stream.
+      //!
+      //! This function reads the output of \ref save from \p is, and sets
+      //! the settings, alphabet, identity, inverses, rules and state of the
+      //! rewriting system of \c this to be those that were saved. Calling
+      //! \ref run after this continues the Knuth-Bendix procedure from where
+      //! it was when \ref save was called.
+      //!
+      //! \param is the stream to read from (which should be opened in binary
+      //! mode).
+      //!
+      //! \returns
+      //! (None)
+      //!
+      //! \throws LibsemigroupsException if the alphabet of \c this has already
+      //! been set, or if \c this has any rules.
+      //! \throws LibsemigroupsException if the input is not valid output of
+      //! \ref save. If this happens, then \c this may be left in an invalid
+      //! state.
+      //!
+      //! \complexity
+      //! Linear in the total length of the rules.
+      //!
+      //! \sa \ref save.
+      void load(std::istream& is);
+
       //! Returns the Gilman digraph.
       //!
       //! \returns A const reference to a \ref ActionDigraph.
@@ -551,6 +837,38 @@ namespace libsemigroups {
       //! (None)
       ActionDigraph<size_t> const& gilman_digraph();
 
+      //! Returns a FroidurePin instance defined by the right Cayley graph.
+      //!
+      //! This function returns a FroidurePin instance isomorphic to the
+      //! semigroup defined by \c this, which must be finite. Unlike
+      //! froidure_pin(), whose elements are represented by words that are
+      //! multiplied by concatenating and rewriting them, the right Cayley
+      //! graph is computed directly from the \ref gilman_digraph (whose paths
+      //! are the normal forms), and elements are represented by their
+      //! indices in this graph. The normal forms are numbered in short-lex
+      //! order, and the returned FroidurePin is fully enumerated by following
+      //! the edges of the Cayley graph. If the reduction ordering is
+      //! options::order::shortlex, then this is usually considerably faster
+      //! than fully enumerating froidure_pin().
+      //!
+      //! If the normal form of some letter is not a single letter, then this
+      //! function returns froidure_pin() (fully enumerated) instead.
+      //!
+      //! \returns A shared pointer to a FroidurePinBase.
+      //!
+      //! \throws LibsemigroupsException if the alphabet has not been set.
+      //! \throws LibsemigroupsException if the semigroup defined by \c this
+      //! is infinite.
+      //!
+      //! \warning This will terminate when the KnuthBendix instance is
+      //! reduced and confluent, which might be never.
+      //!
+      //! \sa \ref gilman_digraph and froidure_pin().
+      //!
+      //! \parameters
+      //! (None)
+      std::shared_ptr<FroidurePinBase> froidure_pin_from_gilman_digraph();
+
       //! Returns whether or not the empty string belongs in the system.
       //!
       //! \returns
@@ -585,6 +903,72 @@ namespace libsemigroups {
       //! \ref gilman_digraph.
       uint64_t number_of_normal_forms(size_t min, size_t max);
 
+      //! Compute the normal forms of many words.
+      //!
+      //! The words are given by a single \string \p words containing all of
+      //! the words one after another, and a vector \p ends where
+      //! <tt>ends[i]</tt> is the position in \p words one after the end of
+      //! the <tt>i</tt>-th word. The normal forms of the words are written
+      //! to \p result and \p result_ends in the same format (replacing their
+      //! previous contents).
+      //!
+      //! The words are rewritten concurrently using up to
+      //! \ref max_threads threads, and without converting any word to a
+      //! separate string, so this is considerably faster than calling
+      //! \ref normal_form repeatedly.
+      //!
+      //! \param words the words, one after another.
+      //! \param ends the positions one after the end of every word.
+      //! \param result the \string to hold the normal forms.
+      //! \param result_ends the vector to hold the positions one after the end
+      //! of every normal form.
+      //!
+      //! \returns
+      //! (None)
+      //!
+      //! \throws LibsemigroupsException if \p ends is not non-decreasing, or
+      //! if its last value is not the length of \p words.
+      //! \throws LibsemigroupsException if any character in \p words does not
+      //! belong to alphabet().
+      //!
+      //! \warning This function calls \ref run, which might never terminate.
+      //!
+      //! \sa \ref normal_form.
+      void normal_forms(std::string const&         words,
+                        std::vector<size_t> const& ends,
+                        std::string&               result,
+                        std::vector<size_t>&       result_ends);
+
+      //! Check equality of many pairs of words.
+      //!
+      //! The words are given in the same format as in \ref normal_forms, and
+      //! <tt>result[i]</tt> is set to \c true if the words with indices
+      //! \f$2i\f$ and \f$2i + 1\f$ represent the same element, and \c false
+      //! if they do not.
+      //!
+      //! The words are rewritten concurrently using up to
+      //! \ref max_threads threads.
+      //!
+      //! \param words the words, one after another.
+      //! \param ends the positions one after the end of every word.
+      //! \param result the vector to hold the results.
+      //!
+      //! \returns
+      //! (None)
+      //!
+      //! \throws LibsemigroupsException if \p ends does not have even length.
+      //! \throws LibsemigroupsException if \p ends is not non-decreasing, or
+      //! if its last value is not the length of \p words.
+      //! \throws LibsemigroupsException if any character in \p words does not
+      //! belong to alphabet().
+      //!
+      //! \warning This function calls \ref run, which might never terminate.
+      //!
+      //! \sa \ref equal_to.
+      void equal_to(std::string const&         words,
+                    std::vector<size_t> const& ends,
+                    std::vector<bool>&         result);
+
       //////////////////////////////////////////////////////////////////////////
       // FpSemigroupInterface - pure virtual member functions - public
       //////////////////////////////////////////////////////////////////////////
@@ -624,6 +1008,12 @@ namespace libsemigroups {
       void init_from(KnuthBendix const&, bool = true);
       void init_from(FroidurePinBase&);
 
+      //////////////////////////////////////////////////////////////////////////
+      // KnuthBendix - validation - private
+      //////////////////////////////////////////////////////////////////////////
+
+      void validate_words(std::string const&, std::vector<size_t> const&) const;
+
       //////////////////////////////////////////////////////////////////////////
       // FpSemigroupInterface - pure virtual member functions - private
       //////////////////////////////////////////////////////////////////////////
@@ -659,10 +1049,17 @@ namespace libsemigroups {
 
       struct Settings {
         Settings();
-        size_t           _check_confluence_interval;
-        size_t           _max_overlap;
-        size_t           _max_rules;
-        options::overlap _overlap_policy;
+        size_t              _check_confluence_interval;
+        size_t              _defer_overlap;
+        bool                _defer_to_disk;
+        size_t              _max_inactive_rules;
+        size_t              _max_overlap;
+        size_t              _max_rules;
+        size_t              _max_stack_depth;
+        size_t              _max_threads;
+        options::order      _order;
+        options::overlap    _overlap_policy;
+        std::vector<size_t> _weights;
       } _settings;
 
       // Forward declarations
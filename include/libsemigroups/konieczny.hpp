@@ -26,8 +26,19 @@
 #define LIBSEMIGROUPS_KONIECZNY_HPP_
 
 #include <algorithm>      // for binary_search
+#include <atomic>         // for atomic
 #include <cstddef>        // for size_t
+#include <cstdint>        // for uint64_t
+#include <exception>      // for exception_ptr, rethrow_exception
+#include <istream>        // for istream
+#include <iterator>       // for distance, advance
+#include <memory>         // for unique_ptr
+#include <mutex>          // for mutex, once_flag
+#include <new>            // for placement new
+#include <ostream>        // for ostream
 #include <set>            // for set
+#include <thread>         // for thread
+#include <tuple>          // for tuple
 #include <type_traits>    // for is_pointer
 #include <unordered_map>  // for unordered_map
 #include <unordered_set>  // for unordered_set
@@ -43,9 +54,36 @@
 #include "pool.hpp"              // for detail::Pool
 #include "report.hpp"            // for REPORT_DEFAULT
 #include "runner.hpp"            // for Runner
+#include "schreier-sims.hpp"     // for SchreierSims
 #include "timer.hpp"             // for Timer
 
 namespace libsemigroups {
+  namespace detail {
+    // The first 8 bytes of the output of Konieczny::save, followed by the
+    // version of the format.
+    constexpr char     KONIECZNY_MAGIC[]  = "LSGKZ\x00\x00\x00";
+    constexpr uint64_t KONIECZNY_VERSION = 1;
+
+    // The type of the stabilizer chains used by Konieczny to represent group
+    // H-classes if there is a GroupHClassPerm for the element type; otherwise
+    // type is a placeholder which is never constructed.
+    template <typename TGroupHClassPerm, typename = void>
+    struct KoniecznyHGroup {
+      static constexpr bool value = false;
+      using type                  = KoniecznyHGroup;
+    };
+
+    template <typename TGroupHClassPerm>
+    struct KoniecznyHGroup<TGroupHClassPerm,
+                           std::enable_if_t<(TGroupHClassPerm::degree > 0)>> {
+      static constexpr bool value = true;
+      using type                  = SchreierSims<
+          TGroupHClassPerm::degree,
+          typename SmallestInteger<TGroupHClassPerm::degree>::type,
+          typename TGroupHClassPerm::type>;
+    };
+  }  // namespace detail
+
   //! Defined in ``konieczny.hpp``.
   //!
   //! This is a traits class for use with Konieczny.
@@ -118,6 +156,9 @@ namespace libsemigroups {
 
     //! \copydoc libsemigroups::Degree
     using Degree = ::libsemigroups::Degree<element_type>;
+
+    //! \copydoc libsemigroups::GroupHClassPerm
+    using GroupHClassPerm = ::libsemigroups::GroupHClassPerm<element_type>;
   };
 
   //! Defined in ``konieczny.hpp``.
@@ -241,6 +282,9 @@ namespace libsemigroups {
     using rank_state_type           = typename TTraits::rank_state_type;
     using left_indices_index_type   = size_t;
     using right_indices_index_type  = size_t;
+    using GroupHClassPerm           = typename TTraits::GroupHClassPerm;
+    using H_group_helper            = detail::KoniecznyHGroup<GroupHClassPerm>;
+    using H_group_type              = typename H_group_helper::type;
 
     ////////////////////////////////////////////////////////////////////////
     // Konieczny - internal structs - private
@@ -283,6 +327,90 @@ namespace libsemigroups {
       }
     };
 
+    // Owns the copies of the elements in the frame of a D-class. If elements
+    // are stored by pointer, then the copies are constructed contiguously in
+    // a few blocks, rather than by one heap allocation each, and they are
+    // all destroyed (and their blocks freed) with the arena. Otherwise,
+    // elements are stored by value and the arena does nothing.
+    //
+    // The stride of a block is sizeof(element_type), and so only elements
+    // whose data is stored inline, such as Transf<N> or PPerm<N> for N != 0,
+    // are stored entirely in the arena. Elements of dynamic degree, such as
+    // Transf<> or PPerm<>, hold their images in a heap allocated
+    // std::vector, which is not replaced by the arena, and so each such
+    // element still costs one allocation (and deallocation). Packing their
+    // images into the arena would require the D-classes to operate on views
+    // of elements rather than on element_type, and this is not done. Small
+    // trivial types, such as Transf<N> for N <= 8 or BMat8, are stored by
+    // value, and so the arena is not used for them either. See the
+    // benchmark "Example 5" in benchmarks/bench-konieczny.cpp.
+    class FrameArena : private detail::BruidhinnTraits<TElementType> {
+      using value_type =
+          typename detail::BruidhinnTraits<TElementType>::value_type;
+      using storage_type =
+          typename std::aligned_storage<sizeof(value_type),
+                                        alignof(value_type)>::type;
+      using is_packed = std::is_pointer<internal_element_type>;
+
+     public:
+      FrameArena() : _blocks(), _size(0) {}
+      FrameArena(FrameArena const&) = delete;
+      FrameArena(FrameArena&&)      = delete;
+      FrameArena& operator=(FrameArena const&) = delete;
+      FrameArena& operator=(FrameArena&&) = delete;
+
+      ~FrameArena() {
+        destroy(std::integral_constant<
+                bool,
+                is_packed::value
+                    && !std::is_trivially_destructible<value_type>::value>());
+      }
+
+      // Returns a copy of x that is owned by the arena.
+      internal_element_type copy(internal_const_reference x) {
+        return copy(x, is_packed());
+      }
+
+     private:
+      internal_element_type copy(internal_const_reference x, std::false_type) {
+        return this->internal_copy(x);
+      }
+
+      internal_element_type copy(internal_const_reference x, std::true_type) {
+        if (_blocks.empty() || _size == _blocks.back().second) {
+          // blocks double in size from 8 up to 1024 elements
+          size_t const n
+              = _blocks.empty()
+                    ? 8
+                    : std::min(2 * _blocks.back().second, size_t(1024));
+          _blocks.emplace_back(
+              std::unique_ptr<storage_type[]>(new storage_type[n]), n);
+          _size = 0;
+        }
+        value_type* ptr
+            = reinterpret_cast<value_type*>(&_blocks.back().first[_size++]);
+        new (ptr) value_type(this->to_external_const(x));
+        return ptr;
+      }
+
+      void destroy(std::false_type) noexcept {}
+
+      void destroy(std::true_type) noexcept {
+        for (size_t i = 0; i < _blocks.size(); ++i) {
+          size_t const n
+              = (i + 1 == _blocks.size() ? _size : _blocks[i].second);
+          value_type* ptr
+              = reinterpret_cast<value_type*>(_blocks[i].first.get());
+          for (size_t j = 0; j < n; ++j) {
+            ptr[j].~value_type();
+          }
+        }
+      }
+
+      std::vector<std::pair<std::unique_ptr<storage_type[]>, size_t>> _blocks;
+      size_t                                                        _size;
+    };
+
     struct OneParamLambda {
       lambda_value_type operator()(const_reference x) const {
         lambda_value_type lval;
@@ -339,12 +467,9 @@ namespace libsemigroups {
           _D_rels(),
           _data_initialised(false),
           _degree(UNDEFINED),
-          _element_pool(),
           _gens(),
-          _group_indices(),
-          _group_indices_rev(),
           _lambda_orb(),
-          _lambda_to_D_map(),
+          _max_threads(1),
           _nonregular_reps(),
           _one(),
           _rank_state(nullptr),
@@ -353,12 +478,11 @@ namespace libsemigroups {
           _reg_reps(),
           _reps_processed(0),
           _rho_orb(),
-          _rho_to_D_map(),
           _run_initialised(false),
-          _tmp_lambda_value1(),
-          _tmp_lambda_value2(),
-          _tmp_rho_value1(),
-          _tmp_rho_value2() {
+          _scc_pairs_to_D_map(),
+          _use_schreier_sims(false),
+          _workspace(),
+          _workspaces() {
       _lambda_orb.cache_scc_multipliers(true);
       _rho_orb.cache_scc_multipliers(true);
     }
@@ -464,6 +588,157 @@ namespace libsemigroups {
       return this->to_external_const(_gens[pos]);
     }
 
+    //! Set the maximum number of threads.
+    //!
+    //! This member function sets the maximum number of threads used to
+    //! compute the \f$\mathscr{D}\f$-classes of each rank. If \p val is
+    //! greater than \c 1, then representatives of the same rank whose lambda-
+    //! and rho-values belong to distinct pairs of strongly connected
+    //! components are processed concurrently; such representatives belong to
+    //! distinct \f$\mathscr{D}\f$-classes. The \f$\mathscr{D}\f$-classes
+    //! found do not depend on \p val, but the order in which they are found
+    //! may. The lambda- and rho-orbits are also enumerated concurrently,
+    //! using about half of the threads each, and so any predicate passed to
+    //! \c run_until may be called from more than one thread.
+    //!
+    //! The default value is \c 1, and a value of \c 0 is treated as \c 1.
+    //!
+    //! \param val the maximum number of threads to use.
+    //!
+    //! \returns A reference to `*this`.
+    //!
+    //! \exceptions
+    //! \noexcept
+    Konieczny& max_threads(size_t val) noexcept {
+      _max_threads = (val == 0 ? 1 : val);
+      return *this;
+    }
+
+    //! The current maximum number of threads.
+    //!
+    //! \parameters
+    //! (None)
+    //!
+    //! \returns
+    //! A value of type \c size_t.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \sa max_threads(size_t).
+    size_t max_threads() const noexcept {
+      return _max_threads;
+    }
+
+    //! Set whether group \f$\mathscr{H}\f$-classes are represented by
+    //! stabilizer chains.
+    //!
+    //! If \p val is \c true, then the group \f$\mathscr{H}\f$-class of each
+    //! regular \f$\mathscr{D}\f$-class is represented by a SchreierSims
+    //! instance, using GroupHClassPerm to represent its elements by
+    //! permutations, rather than by a list of its elements. The sizes of the
+    //! \f$\mathscr{D}\f$-classes, and membership in them, are then
+    //! determined without listing the \f$\mathscr{H}\f$-classes; this
+    //! can be much faster, and use much less memory, if the maximal subgroups
+    //! are large. An \f$\mathscr{H}\f$-class is still listed if it is
+    //! required, such as when computing a non-regular
+    //! \f$\mathscr{D}\f$-class below it, iterating through the elements of a
+    //! \f$\mathscr{D}\f$-class, or calling \ref save.
+    //!
+    //! The default value is \c false.
+    //!
+    //! \param val whether or not to use stabilizer chains.
+    //!
+    //! \returns A reference to `*this`.
+    //!
+    //! \throws LibsemigroupsException if \p val is \c true and there is no
+    //! specialization of GroupHClassPerm for \ref element_type.
+    //! \throws LibsemigroupsException if \ref started returns \c true.
+    Konieczny& use_schreier_sims(bool val) {
+      if (val && !H_group_helper::value) {
+        LIBSEMIGROUPS_EXCEPTION("the group H-classes of this element type "
+                                "cannot be represented by permutations");
+      } else if (started()) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "cannot change the representation of H-classes after the "
+            "algorithm has begun!");
+      }
+      _use_schreier_sims = val;
+      return *this;
+    }
+
+    //! Whether group \f$\mathscr{H}\f$-classes are represented by
+    //! stabilizer chains.
+    //!
+    //! \parameters
+    //! (None)
+    //!
+    //! \returns
+    //! A value of type \c bool.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \sa use_schreier_sims(bool).
+    bool use_schreier_sims() const noexcept {
+      return _use_schreier_sims;
+    }
+
+    //! Write the computed data of a Konieczny instance to a stream.
+    //!
+    //! This function writes the generators, the frames of the
+    //! \f$\mathscr{D}\f$-classes computed so far, and the representatives
+    //! waiting to be processed to \p os in a binary format. The output can be
+    //! read by \ref load, so that the computation can be resumed, or the
+    //! \f$\mathscr{D}\f$-classes queried, without computing them again.
+    //!
+    //! Elements are written as their bytes, and so this function is only
+    //! available if \ref element_type is trivially copyable (such as BMat8,
+    //! Transf<N> or PPerm<N> with \c N non-zero); the output should only
+    //! be read on the same platform.
+    //!
+    //! \param os the stream to write to (which should be opened in binary
+    //! mode).
+    //!
+    //! \returns
+    //! (None)
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    //!
+    //! \warning This function should not be called while \ref run is being
+    //! called in another thread.
+    //!
+    //! \note This function is not \c const because the
+    //! \f$\mathscr{H}\f$-classes of the \f$\mathscr{D}\f$-classes are
+    //! listed, if they have not been already, so that they can be written
+    //! (see use_schreier_sims(bool)).
+    //!
+    //! \sa \ref load.
+    void save(std::ostream& os);
+
+    //! Read the computed data of a Konieczny instance from a stream.
+    //!
+    //! This function reads the output of \ref save from \p is into \c this.
+    //! The lambda- and rho-orbits are recomputed from the generators, which
+    //! is deterministic, and the frames of the \f$\mathscr{D}\f$-classes are
+    //! read rather than recomputed. Calling \ref run after this continues
+    //! from where the computation was when \ref save was called.
+    //!
+    //! \param is the stream to read from (which should be opened in binary
+    //! mode).
+    //!
+    //! \returns
+    //! (None)
+    //!
+    //! \throws LibsemigroupsException if \c this already has generators.
+    //! \throws LibsemigroupsException if the input is not valid output of
+    //! \ref save for the same element type. If this happens, then \c this may
+    //! be left in an invalid state.
+    //!
+    //! \sa \ref save.
+    void load(std::istream& is);
+
     //! Returns the number of \f$\mathscr{D}\f$-classes.
     //!
     //! \parameters
@@ -923,6 +1198,56 @@ namespace libsemigroups {
       return contains(x) && is_regular_element_NC(this->to_internal_const(x));
     }
 
+    //! Test membership of a range of elements.
+    //!
+    //! Returns a \c std::vector<bool> whose \c i-th entry is \c true if the
+    //! \c i-th element in the range \p first to \p last belongs to \c this
+    //! and \c false if it does not. If max_threads() is greater than \c 1,
+    //! then the range is split into contiguous parts that are tested
+    //! concurrently.
+    //!
+    //! \tparam T the type of the iterators, whose values must be of type
+    //! \ref const_reference.
+    //!
+    //! \param first iterator pointing to the first element to test.
+    //! \param last iterator pointing one beyond the last element to test.
+    //!
+    //! \returns A value of type \c std::vector<bool>.
+    //!
+    //! \throws LibsemigroupsException if the full enumeration does not
+    //! finish, for example because kill() was called.
+    //!
+    //! \note This function triggers a full enumeration.
+    template <typename T>
+    std::vector<bool> contains(T first, T last) {
+      return test_elements(first, last, false);
+    }
+
+    //! Test regularity of a range of elements.
+    //!
+    //! Returns a \c std::vector<bool> whose \c i-th entry is \c true if the
+    //! \c i-th element in the range \p first to \p last belongs to \c this
+    //! and is regular, and \c false if it does not. If max_threads() is
+    //! greater than \c 1, then the range is split into contiguous parts that
+    //! are tested concurrently.
+    //!
+    //! \tparam T the type of the iterators, whose values must be of type
+    //! \ref const_reference.
+    //!
+    //! \param first iterator pointing to the first element to test.
+    //! \param last iterator pointing one beyond the last element to test.
+    //!
+    //! \returns A value of type \c std::vector<bool>.
+    //!
+    //! \throws LibsemigroupsException if the full enumeration does not
+    //! finish, for example because kill() was called.
+    //!
+    //! \note This function triggers a full enumeration.
+    template <typename T>
+    std::vector<bool> is_regular_element(T first, T last) {
+      return test_elements(first, last, true);
+    }
+
     //! Add a copy of an element to the generators.
     //!
     //! It is possible, if perhaps not desirable,  to add the same generator
@@ -1201,6 +1526,54 @@ namespace libsemigroups {
    private:
     using PoolGuard = detail::PoolGuard<internal_element_type>;
 
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - workspaces - private
+    ////////////////////////////////////////////////////////////////////////
+
+    // The temporary values, element pool, and cache of group indices used by
+    // the utility member functions below and by the D-classes. Every thread
+    // used in run_impl has its own workspace, so that D-classes can be
+    // computed concurrently.
+    struct Workspace {
+      Workspace()
+          : _element_pool(),
+            _group_indices(),
+            _group_indices_rev(),
+            _tmp_lambda_value1(),
+            _tmp_lambda_value2(),
+            _tmp_rho_value1(),
+            _tmp_rho_value2() {}
+
+      void init(const_reference x) {
+        _tmp_lambda_value1 = OneParamLambda()(x);
+        _tmp_lambda_value2 = OneParamLambda()(x);
+        _tmp_rho_value1    = OneParamRho()(x);
+        _tmp_rho_value2    = OneParamRho()(x);
+      }
+
+      detail::Pool<internal_element_type> _element_pool;
+      std::unordered_map<
+          std::pair<rho_orb_index_type, lambda_orb_scc_index_type>,
+          lambda_orb_index_type,
+          PairHash>
+          _group_indices;
+      std::unordered_map<
+          std::pair<rho_orb_scc_index_type, lambda_orb_index_type>,
+          rho_orb_index_type,
+          PairHash>
+                        _group_indices_rev;
+      lambda_value_type _tmp_lambda_value1;
+      lambda_value_type _tmp_lambda_value2;
+      rho_value_type    _tmp_rho_value1;
+      rho_value_type    _tmp_rho_value2;
+    };
+
+    // Returns the workspace of the calling thread, which is _workspace unless
+    // the thread was started by run_impl.
+    Workspace& workspace() const noexcept {
+      return _thread_workspace == nullptr ? _workspace : *_thread_workspace;
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // Konieczny - utility methods - private
     ////////////////////////////////////////////////////////////////////////
@@ -1214,25 +1587,32 @@ namespace libsemigroups {
     // Returns a lambda orb index corresponding to a group H-class in the R-
     // class of \p x.
     // asserts its argument has lambda/rho values in the orbits.
-    // modifies _tmp_lambda_value1
-    // modifies _tmp_rho_value1
+    // modifies _tmp_lambda_value1 of workspace()
+    // modifies _tmp_rho_value1 of workspace()
     lambda_orb_index_type get_lambda_group_index(internal_const_reference x) {
-      Rho()(_tmp_rho_value1, this->to_external_const(x));
-      Lambda()(_tmp_lambda_value1, this->to_external_const(x));
-      lambda_orb_index_type lpos = _lambda_orb.position(_tmp_lambda_value1);
+      Workspace& ws = workspace();
+      Rho()(ws._tmp_rho_value1, this->to_external_const(x));
+      Lambda()(ws._tmp_lambda_value1, this->to_external_const(x));
+      lambda_orb_index_type lpos = _lambda_orb.position(ws._tmp_lambda_value1);
       LIBSEMIGROUPS_ASSERT(lpos != UNDEFINED);
 
       lambda_orb_scc_index_type lval_scc_id
           = _lambda_orb.digraph().scc_id(lpos);
 
       std::pair<rho_orb_index_type, lambda_orb_scc_index_type> key(
-          _rho_orb.position(_tmp_rho_value1), lval_scc_id);
-
-      if (_group_indices.find(key) != _group_indices.end()) {
-        return _group_indices.at(key);
+          _rho_orb.position(ws._tmp_rho_value1), lval_scc_id);
+
+      auto gi = ws._group_indices.find(key);
+      if (gi != ws._group_indices.end()) {
+        return gi->second;
+      } else if (&ws != &_workspace
+                 && (gi = _workspace._group_indices.find(key))
+                        != _workspace._group_indices.end()) {
+        // _workspace is not modified while other threads are running
+        return gi->second;
       } else {
-        PoolGuard             cg1(_element_pool);
-        PoolGuard             cg2(_element_pool);
+        PoolGuard             cg1(ws._element_pool);
+        PoolGuard             cg2(ws._element_pool);
         internal_element_type tmp1 = cg1.get();
         internal_element_type tmp2 = cg2.get();
 
@@ -1246,34 +1626,41 @@ namespace libsemigroups {
                     this->to_external(tmp1),
                     _lambda_orb.multiplier_from_scc_root(*it));
           if (is_group_index(x, tmp2)) {
-            _group_indices.emplace(key, *it);
+            ws._group_indices.emplace(key, *it);
             return *it;
           }
         }
       }
-      _group_indices.emplace(key, UNDEFINED);
+      ws._group_indices.emplace(key, UNDEFINED);
       return UNDEFINED;
     }
 
     // Finds a group index of a H-class in the L-class of \p x.
-    // modifies _tmp_lambda_value1
-    // modifies _tmp_rho_value1
+    // modifies _tmp_lambda_value1 of workspace()
+    // modifies _tmp_rho_value1 of workspace()
     rho_orb_index_type get_rho_group_index(internal_const_reference x) {
-      Rho()(_tmp_rho_value1, this->to_external_const(x));
-      Lambda()(_tmp_lambda_value1, this->to_external_const(x));
-      rho_orb_index_type rpos = _rho_orb.position(_tmp_rho_value1);
+      Workspace& ws = workspace();
+      Rho()(ws._tmp_rho_value1, this->to_external_const(x));
+      Lambda()(ws._tmp_lambda_value1, this->to_external_const(x));
+      rho_orb_index_type rpos = _rho_orb.position(ws._tmp_rho_value1);
       LIBSEMIGROUPS_ASSERT(rpos != UNDEFINED);
       rho_orb_scc_index_type rval_scc_id = _rho_orb.digraph().scc_id(rpos);
 
       std::pair<rho_orb_scc_index_type, lambda_orb_index_type> key(
-          rval_scc_id, _lambda_orb.position(_tmp_lambda_value1));
-
-      if (_group_indices_rev.find(key) != _group_indices_rev.end()) {
-        return _group_indices_rev.at(key);
+          rval_scc_id, _lambda_orb.position(ws._tmp_lambda_value1));
+
+      auto gi = ws._group_indices_rev.find(key);
+      if (gi != ws._group_indices_rev.end()) {
+        return gi->second;
+      } else if (&ws != &_workspace
+                 && (gi = _workspace._group_indices_rev.find(key))
+                        != _workspace._group_indices_rev.end()) {
+        // _workspace is not modified while other threads are running
+        return gi->second;
       } else {
-        PoolGuard             cg1(_element_pool);
+        PoolGuard             cg1(ws._element_pool);
         internal_element_type tmp1 = cg1.get();
-        PoolGuard             cg2(_element_pool);
+        PoolGuard             cg2(ws._element_pool);
         internal_element_type tmp2 = cg2.get();
 
         Product()(this->to_external(tmp1),
@@ -1286,12 +1673,12 @@ namespace libsemigroups {
                     _rho_orb.multiplier_from_scc_root(*it),
                     this->to_external(tmp1));
           if (is_group_index(tmp2, x)) {
-            _group_indices_rev.emplace(key, *it);
+            ws._group_indices_rev.emplace(key, *it);
             return *it;
           }
         }
       }
-      _group_indices_rev.emplace(key, UNDEFINED);
+      ws._group_indices_rev.emplace(key, UNDEFINED);
       return UNDEFINED;
     }
 
@@ -1301,7 +1688,7 @@ namespace libsemigroups {
     void idem_in_H_class(internal_reference       res,
                          internal_const_reference x) const {
       this->to_external(res) = this->to_external_const(x);
-      PoolGuard             cg(_element_pool);
+      PoolGuard             cg(element_pool());
       internal_element_type tmp = cg.get();
       do {
         Swap()(this->to_external(res), this->to_external(tmp));
@@ -1316,10 +1703,11 @@ namespace libsemigroups {
 
     //! Finds an idempotent in the \f$\mathscr{D}\f$-class of \c x, if \c x is
     //! regular, and modifies \c x in place to be this idempotent
-    // modifies _tmp_lambda_value1
+    // modifies _tmp_lambda_value1 of workspace()
     void make_idem(internal_reference x) {
       LIBSEMIGROUPS_ASSERT(is_regular_element_NC(x));
-      PoolGuard             cg1(_element_pool);
+      Workspace&            ws = workspace();
+      PoolGuard             cg1(ws._element_pool);
       internal_element_type tmp1 = cg1.get();
 
       Product()(this->to_external(tmp1),
@@ -1330,10 +1718,10 @@ namespace libsemigroups {
       }
 
       lambda_orb_index_type i = get_lambda_group_index(x);
-      Lambda()(_tmp_lambda_value1, this->to_external_const(x));
-      lambda_orb_index_type pos = _lambda_orb.position(_tmp_lambda_value1);
+      Lambda()(ws._tmp_lambda_value1, this->to_external_const(x));
+      lambda_orb_index_type pos = _lambda_orb.position(ws._tmp_lambda_value1);
 
-      PoolGuard             cg2(_element_pool);
+      PoolGuard             cg2(ws._element_pool);
       internal_element_type tmp2 = cg2.get();
       Product()(this->to_external(tmp1),
                 this->to_external_const(x),
@@ -1352,7 +1740,7 @@ namespace libsemigroups {
     void group_inverse(internal_element_type&   res,
                        internal_const_reference id,
                        internal_const_reference x) const {
-      PoolGuard             cg(_element_pool);
+      PoolGuard             cg(element_pool());
       internal_element_type tmp = cg.get();
       this->to_external(tmp)    = this->to_external_const(x);
       do {
@@ -1364,22 +1752,23 @@ namespace libsemigroups {
     }
 
     //! Determines whether <tt>(x, y)</tt> forms a group index.
-    // modifies _tmp_lambda_value and _tmp_rho_value
+    // modifies _tmp_lambda_value and _tmp_rho_value of workspace()
     bool is_group_index(internal_const_reference x,
                         internal_const_reference y) const {
-      PoolGuard             cg(_element_pool);
+      Workspace&            ws = workspace();
+      PoolGuard             cg(ws._element_pool);
       internal_element_type tmp = cg.get();
 
       Product()(this->to_external(tmp),
                 this->to_external_const(y),
                 this->to_external_const(x));
-      Lambda()(_tmp_lambda_value1, this->to_external(tmp));
-      Rho()(_tmp_rho_value1, this->to_external(tmp));
-      Lambda()(_tmp_lambda_value2, this->to_external_const(x));
-      Rho()(_tmp_rho_value2, this->to_external_const(y));
+      Lambda()(ws._tmp_lambda_value1, this->to_external(tmp));
+      Rho()(ws._tmp_rho_value1, this->to_external(tmp));
+      Lambda()(ws._tmp_lambda_value2, this->to_external_const(x));
+      Rho()(ws._tmp_rho_value2, this->to_external_const(y));
 
-      return _tmp_lambda_value1 == _tmp_lambda_value2
-             && _tmp_rho_value1 == _tmp_rho_value2;
+      return ws._tmp_lambda_value1 == ws._tmp_lambda_value2
+             && ws._tmp_rho_value1 == ws._tmp_rho_value2;
     }
 
     // pass full_check = true to use the contains method of the D-classes
@@ -1391,44 +1780,41 @@ namespace libsemigroups {
             = InternalRank()(_rank_state, this->to_external_const(x));
         run_until([this, rnk]() -> bool { return max_rank() < rnk; });
       }
-
-      Lambda()(_tmp_lambda_value1, this->to_external_const(x));
-      Rho()(_tmp_rho_value1, this->to_external_const(x));
-      lambda_orb_index_type lpos = _lambda_orb.position(_tmp_lambda_value1);
-      lambda_orb_index_type rpos = _rho_orb.position(_tmp_rho_value1);
+      return find_D_class(x, full_check);
+    }
+
+    // Returns the index of the D-class containing \p x among those already
+    // computed, without running; this is safe to call from several threads
+    // at once once the D-classes are no longer changing.
+    D_class_index_type find_D_class(internal_const_reference x,
+                                    bool const               full_check) {
+      Workspace& ws = workspace();
+      Lambda()(ws._tmp_lambda_value1, this->to_external_const(x));
+      Rho()(ws._tmp_rho_value1, this->to_external_const(x));
+      lambda_orb_index_type lpos = _lambda_orb.position(ws._tmp_lambda_value1);
+      lambda_orb_index_type rpos = _rho_orb.position(ws._tmp_rho_value1);
       if (lpos == UNDEFINED || rpos == UNDEFINED) {
         // this should only be possible if this function was called from a
         // public function, and hence full_check is true.
         LIBSEMIGROUPS_ASSERT(full_check);
         return UNDEFINED;
       }
-      auto l_it = _lambda_to_D_map.find(lpos);
-      auto r_it = _rho_to_D_map.find(rpos);
-      if (l_it != _lambda_to_D_map.end() && r_it != _rho_to_D_map.end()) {
-        auto l_D_it  = l_it->second.cbegin();
-        auto l_D_end = l_it->second.cend();
-        auto r_D_it  = r_it->second.cbegin();
-        auto r_D_end = r_it->second.cend();
-        // the vectors should already be sorted given how we create them
-        LIBSEMIGROUPS_ASSERT(std::is_sorted(l_D_it, l_D_end));
-        LIBSEMIGROUPS_ASSERT(std::is_sorted(r_D_it, r_D_end));
-        while (l_D_it != l_D_end && r_D_it != r_D_end) {
-          if (*l_D_it < *r_D_it) {
-            ++l_D_it;
-          } else {
-            if (*r_D_it == *l_D_it) {
-              if (full_check) {
-                if (_D_classes[*l_D_it]->contains(
-                        this->to_external_const(x), lpos, rpos)) {
-                  return *l_D_it;
-                }
-              } else {
-                if (_D_classes[*l_D_it]->contains_NC(x, lpos, rpos)) {
-                  return *l_D_it;
-                }
-              }
+      // Every element of a D-class has its lambda- and rho-values in the same
+      // pair of strongly connected components, and so only the D-classes
+      // with that pair need to be checked; the positions lpos and rpos are
+      // reused for every such D-class.
+      auto it = _scc_pairs_to_D_map.find(
+          std::make_pair(_lambda_orb.digraph().scc_id(lpos),
+                         _rho_orb.digraph().scc_id(rpos)));
+      if (it != _scc_pairs_to_D_map.end()) {
+        for (D_class_index_type d : it->second) {
+          if (full_check) {
+            if (_D_classes[d]->contains(
+                    this->to_external_const(x), lpos, rpos)) {
+              return d;
             }
-            ++r_D_it;
+          } else if (_D_classes[d]->contains_NC(x, lpos, rpos)) {
+            return d;
           }
         }
       }
@@ -1438,14 +1824,15 @@ namespace libsemigroups {
     void add_to_D_maps(D_class_index_type d) {
       LIBSEMIGROUPS_ASSERT(d < _D_classes.size());
       DClass* D = _D_classes[d];
-      for (auto it = D->cbegin_left_indices(); it < D->cend_left_indices();
-           ++it) {
-        _lambda_to_D_map[*it].push_back(d);
-      }
-      for (auto it = D->cbegin_right_indices(); it < D->cend_right_indices();
-           ++it) {
-        _rho_to_D_map[*it].push_back(d);
-      }
+      LIBSEMIGROUPS_ASSERT(D->cbegin_left_indices() < D->cend_left_indices());
+      LIBSEMIGROUPS_ASSERT(D->cbegin_right_indices()
+                           < D->cend_right_indices());
+      _scc_pairs_to_D_map[std::make_pair(
+                              _lambda_orb.digraph().scc_id(
+                                  *D->cbegin_left_indices()),
+                              _rho_orb.digraph().scc_id(
+                                  *D->cbegin_right_indices()))]
+          .push_back(d);
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -1465,7 +1852,7 @@ namespace libsemigroups {
     }
 
     detail::Pool<internal_element_type>& element_pool() const {
-      return _element_pool;
+      return workspace()._element_pool;
     }
 
     size_t max_rank() const noexcept {
@@ -1475,6 +1862,74 @@ namespace libsemigroups {
       return *_ranks.rbegin();
     }
 
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - serialization member functions - private
+    ////////////////////////////////////////////////////////////////////////
+
+    // Integers are written as 8 bytes, least significant byte first, as in
+    // KnuthBendix::save, and elements as their bytes.
+    static void write_integer(std::ostream& os, uint64_t val) {
+      char buf[8];
+      for (size_t i = 0; i < 8; ++i) {
+        buf[i] = static_cast<char>((val >> (8 * i)) & 0xFF);
+      }
+      os.write(buf, 8);
+    }
+
+    static uint64_t read_integer(std::istream& is) {
+      char buf[8];
+      if (!is.read(buf, 8)) {
+        LIBSEMIGROUPS_EXCEPTION("unexpected end of input");
+      }
+      uint64_t val = 0;
+      for (size_t i = 0; i < 8; ++i) {
+        val |= static_cast<uint64_t>(static_cast<unsigned char>(buf[i]))
+               << (8 * i);
+      }
+      return val;
+    }
+
+    static void write_indices(std::ostream& os, std::vector<size_t> const& v) {
+      write_integer(os, v.size());
+      for (size_t i : v) {
+        write_integer(os, i);
+      }
+    }
+
+    static void read_indices(std::istream& is, std::vector<size_t>& v) {
+      uint64_t const n = read_integer(is);
+      for (uint64_t i = 0; i < n; ++i) {
+        v.push_back(read_integer(is));
+      }
+    }
+
+    static void write_element(std::ostream& os, const_reference x) {
+      static_assert(std::is_trivially_copyable<element_type>::value,
+                    "Konieczny::save and Konieczny::load require the element "
+                    "type to be trivially copyable");
+      os.write(reinterpret_cast<char const*>(&x), sizeof(element_type));
+    }
+
+    static element_type read_element(std::istream& is) {
+      static_assert(std::is_trivially_copyable<element_type>::value,
+                    "Konieczny::save and Konieczny::load require the element "
+                    "type to be trivially copyable");
+      typename std::aligned_storage<sizeof(element_type),
+                                    alignof(element_type)>::type buf;
+      if (!is.read(reinterpret_cast<char*>(&buf), sizeof(element_type))) {
+        LIBSEMIGROUPS_EXCEPTION("unexpected end of input");
+      }
+      return *reinterpret_cast<element_type const*>(&buf);
+    }
+
+    void write_elements(std::ostream&                             os,
+                        std::vector<internal_element_type> const& v) const {
+      write_integer(os, v.size());
+      for (internal_const_reference x : v) {
+        write_element(os, this->to_external_const(x));
+      }
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // Konieczny - initialisation member functions - private
     ////////////////////////////////////////////////////////////////////////
@@ -1494,18 +1949,14 @@ namespace libsemigroups {
 
       element_type x = this->to_external_const(_gens[0]);
 
-      _tmp_lambda_value1 = OneParamLambda()(x);
-      _tmp_lambda_value2 = OneParamLambda()(x);
-
-      _tmp_rho_value1 = OneParamRho()(x);
-      _tmp_rho_value2 = OneParamRho()(x);
+      _workspace.init(x);
 
       // if _one is created but not immediately push into _gens
       // it won't be freed if there are exceptions thrown!
       _one = this->to_internal(One()(x));
       _gens.push_back(_one);  // TODO(later): maybe not this
 
-      _element_pool.init(_one);
+      _workspace._element_pool.init(_one);
 
       _rank_state = new rank_state_type(cbegin_generators(), cend_generators());
       LIBSEMIGROUPS_ASSERT((_rank_state == nullptr)
@@ -1540,8 +1991,39 @@ namespace libsemigroups {
           _rho_orb.add_generator(this->to_external_const(g));
         }
       }
-      _lambda_orb.run_until([this]() -> bool { return this->stopped(); });
-      _rho_orb.run_until([this]() -> bool { return this->stopped(); });
+      auto stppd = [this]() -> bool { return this->stopped(); };
+      // The threads are split between the two orbits, which are independent.
+      _lambda_orb.max_threads((_max_threads + 1) / 2);
+      _rho_orb.max_threads(std::max(_max_threads / 2, size_t(1)));
+      if (_max_threads > 1) {
+        // The orbits are enumerated concurrently; in this case stopped(), and
+        // hence any predicate passed to run_until, is also called from the
+        // second thread. An exception thrown in either thread is only
+        // rethrown once the second thread has been joined.
+        std::exception_ptr rho_error;
+        std::thread        rho_thread([this, &stppd, &rho_error]() {
+          try {
+            _rho_orb.run_until(stppd);
+          } catch (...) {
+            rho_error = std::current_exception();
+          }
+        });
+        std::exception_ptr lambda_error;
+        try {
+          _lambda_orb.run_until(stppd);
+        } catch (...) {
+          lambda_error = std::current_exception();
+        }
+        rho_thread.join();
+        if (lambda_error != nullptr) {
+          std::rethrow_exception(lambda_error);
+        } else if (rho_error != nullptr) {
+          std::rethrow_exception(rho_error);
+        }
+      } else {
+        _lambda_orb.run_until(stppd);
+        _rho_orb.run_until(stppd);
+      }
       REPORT_DEFAULT("found %llu lambda-values and %llu rho-values in %s\n",
                      static_cast<uint64_t>(_lambda_orb.current_size()),
                      static_cast<uint64_t>(_rho_orb.current_size()),
@@ -1585,6 +2067,17 @@ namespace libsemigroups {
     void run_impl() override;
     void run_report();
 
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - concurrency member functions - private
+    ////////////////////////////////////////////////////////////////////////
+    void init_workspaces();
+    void merge_group_indices();
+    void add_D_classes_concurrently(
+        std::vector<std::pair<internal_element_type, D_class_index_type>>&,
+        bool);
+    template <typename T>
+    std::vector<bool> test_elements(T, T, bool);
+
     ////////////////////////////////////////////////////////////////////////
     // Konieczny - data - private
     ////////////////////////////////////////////////////////////////////////
@@ -1593,19 +2086,9 @@ namespace libsemigroups {
     std::vector<std::vector<D_class_index_type>> _D_rels;
     bool                                         _data_initialised;
     size_t                                       _degree;
-    mutable detail::Pool<internal_element_type>  _element_pool;
     std::vector<internal_element_type>           _gens;
-    std::unordered_map<std::pair<rho_orb_index_type, lambda_orb_scc_index_type>,
-                       lambda_orb_index_type,
-                       PairHash>
-        _group_indices;
-    std::unordered_map<std::pair<rho_orb_scc_index_type, lambda_orb_index_type>,
-                       rho_orb_index_type,
-                       PairHash>
-                    _group_indices_rev;
-    lambda_orb_type _lambda_orb;
-    std::unordered_map<lambda_orb_index_type, std::vector<D_class_index_type>>
-        _lambda_to_D_map;
+    lambda_orb_type                              _lambda_orb;
+    size_t                                       _max_threads;
     std::vector<
         std::vector<std::pair<internal_element_type, D_class_index_type>>>
                                 _nonregular_reps;
@@ -1618,15 +2101,24 @@ namespace libsemigroups {
                  _reg_reps;
     size_t       _reps_processed;
     rho_orb_type _rho_orb;
-    std::unordered_map<rho_orb_index_type, std::vector<D_class_index_type>>
-                              _rho_to_D_map;
-    bool                      _run_initialised;
-    mutable lambda_value_type _tmp_lambda_value1;
-    mutable lambda_value_type _tmp_lambda_value2;
-    mutable rho_value_type    _tmp_rho_value1;
-    mutable rho_value_type    _tmp_rho_value2;
+    bool         _run_initialised;
+    std::unordered_map<std::pair<lambda_orb_scc_index_type,
+                                 rho_orb_scc_index_type>,
+                       std::vector<D_class_index_type>,
+                       PairHash>
+                                            _scc_pairs_to_D_map;
+    bool                                    _use_schreier_sims;
+    mutable Workspace                       _workspace;
+    std::vector<std::unique_ptr<Workspace>> _workspaces;
+
+    static thread_local Workspace* _thread_workspace;
   };
 
+  template <typename TElementType, typename TTraits>
+  thread_local typename Konieczny<TElementType, TTraits>::Workspace*
+      Konieczny<TElementType, TTraits>::_thread_workspace
+      = nullptr;
+
   /////////////////////////////////////////////////////////////////////////////
   // DClass
   /////////////////////////////////////////////////////////////////////////////
@@ -1690,7 +2182,8 @@ namespace libsemigroups {
     ////////////////////////////////////////////////////////////////////////
 
     DClass(Konieczny* parent, internal_reference rep)
-        : _class_computed(false),
+        : _arena(),
+          _class_computed(false),
           _H_class(),
           _H_class_computed(false),
           _left_indices(),
@@ -1721,15 +2214,9 @@ namespace libsemigroups {
     ////////////////////////////////////////////////////////////////////////
     virtual ~DClass() {
       // the user of _tmp_internal_vec/_tmp_internal_set is responsible for
-      // freeing any necessary elements
-      InternalVecFree()(_H_class);
-      InternalVecFree()(_left_mults);
-      InternalVecFree()(_left_mults_inv);
-      InternalVecFree()(_left_reps);
+      // freeing any necessary elements, and the elements of the frame are
+      // freed by _arena.
       this->internal_free(_rep);
-      InternalVecFree()(_right_mults);
-      InternalVecFree()(_right_mults_inv);
-      InternalVecFree()(_right_reps);
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -1825,7 +2312,7 @@ namespace libsemigroups {
     //!
     //! \exceptions
     //! \no_libsemigroups_except
-    size_t size_H_class() const {
+    virtual size_t size_H_class() const {
       // compute_H_class();
       LIBSEMIGROUPS_ASSERT(_H_class.size() > 0);
       LIBSEMIGROUPS_ASSERT(this->class_computed());
@@ -1879,6 +2366,167 @@ namespace libsemigroups {
       return 0;
     }
 
+    ////////////////////////////////////////////////////////////////////////
+    // DClass - element iterators - public
+    ////////////////////////////////////////////////////////////////////////
+
+    //! A forward iterator over the elements of a \f$\mathscr{D}\f$-class.
+    //!
+    //! The elements are not stored, but are computed one at a time from the
+    //! frame of the \f$\mathscr{D}\f$-class, as products of the form
+    //! <tt>r * h * l</tt> where \c r is a right multiplier, \c h belongs to
+    //! the \f$\mathscr{H}\f$-class of the representative, and \c l is a left
+    //! multiplier. Incrementing the iterator involves one product, or two
+    //! when it moves to the next \f$\mathscr{H}\f$-class element.
+    //!
+    //! The value referred to by an iterator is only valid until the iterator
+    //! is next incremented.
+    class const_element_iterator {
+      friend class DClass;
+
+     public:
+      //! No doc
+      using size_type = size_t;
+      //! No doc
+      using difference_type = std::ptrdiff_t;
+      //! No doc
+      using const_pointer = element_type const*;
+      //! No doc
+      using pointer = element_type const*;
+      //! No doc
+      using const_reference = element_type const&;
+      //! No doc
+      using reference = element_type const&;
+      //! No doc
+      using value_type = element_type;
+      //! No doc
+      using iterator_category = std::forward_iterator_tag;
+
+      //! No doc
+      const_element_iterator(const_element_iterator const&) = default;
+      //! No doc
+      const_element_iterator(const_element_iterator&&) = default;
+      //! No doc
+      const_element_iterator& operator=(const_element_iterator const&)
+          = default;
+      //! No doc
+      const_element_iterator& operator=(const_element_iterator&&) = default;
+      ~const_element_iterator() = default;
+
+      //! No doc
+      bool operator==(const_element_iterator const& that) const noexcept {
+        return _r == that._r && _h == that._h && _l == that._l;
+      }
+
+      //! No doc
+      bool operator!=(const_element_iterator const& that) const noexcept {
+        return !(this->operator==(that));
+      }
+
+      //! No doc
+      const_reference operator*() const noexcept {
+        return _current;
+      }
+
+      //! No doc
+      const_pointer operator->() const noexcept {
+        return &_current;
+      }
+
+      //! No doc
+      const_element_iterator const& operator++() {
+        if (++_l == _D->_left_mults.size()) {
+          _l = 0;
+          if (++_h == _D->_H_class.size()) {
+            _h = 0;
+            ++_r;
+          }
+          if (_r == _D->_right_mults.size()) {
+            return *this;
+          }
+          update_prefix();
+        }
+        update_current();
+        return *this;
+      }
+
+      //! No doc
+      const_element_iterator operator++(int) {
+        const_element_iterator copy(*this);
+        ++(*this);
+        return copy;
+      }
+
+     private:
+      const_element_iterator(DClass const* D, size_t r)
+          : _current(D->rep()), _D(D), _h(0), _l(0), _prefix(D->rep()), _r(r) {
+        LIBSEMIGROUPS_ASSERT(D->class_computed());
+        if (_r < _D->_right_mults.size()) {
+          update_prefix();
+          update_current();
+        }
+      }
+
+      void update_prefix() {
+        Product()(_prefix,
+                  _D->to_external_const(_D->_right_mults[_r]),
+                  _D->to_external_const(_D->_H_class[_h]));
+      }
+
+      void update_current() {
+        Product()(_current,
+                  _prefix,
+                  _D->to_external_const(_D->_left_mults[_l]));
+      }
+
+      element_type  _current;
+      DClass const* _D;
+      size_t        _h;
+      size_t        _l;
+      element_type  _prefix;
+      size_t        _r;
+    };
+
+    //! Returns a const iterator pointing to the first element.
+    //!
+    //! The elements of \c this are computed as the iterator is incremented,
+    //! and are not stored.
+    //!
+    //! \parameters
+    //! (None)
+    //!
+    //! \returns
+    //! A value of type \ref const_element_iterator.
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    //!
+    //! \complexity
+    //! Constant.
+    const_element_iterator cbegin_elements() const {
+      // The H-class of a regular D-class is only listed on demand if it is
+      // represented by a stabilizer chain, see Konieczny::use_schreier_sims.
+      const_cast<DClass*>(this)->compute_H_class();
+      return const_element_iterator(this, 0);
+    }
+
+    //! Returns a const iterator pointing one past the last element.
+    //!
+    //! \parameters
+    //! (None)
+    //!
+    //! \returns
+    //! A value of type \ref const_element_iterator.
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    //!
+    //! \complexity
+    //! Constant.
+    const_element_iterator cend_elements() const {
+      return const_element_iterator(this, _right_mults.size());
+    }
+
    protected:
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
     ////////////////////////////////////////////////////////////////////////
@@ -1965,6 +2613,75 @@ namespace libsemigroups {
     virtual void compute_right_reps()      = 0;
     virtual void compute_H_class()         = 0;
 
+    ////////////////////////////////////////////////////////////////////////
+    // DClass - serialization member functions - protected
+    ////////////////////////////////////////////////////////////////////////
+
+    // Writes the frame of this, except for the representative, to os. This is
+    // not virtual so that it is only instantiated if Konieczny::save is used.
+    void write(std::ostream& os) const {
+      konieczny_type::write_indices(os, _left_indices);
+      konieczny_type::write_indices(os, _right_indices);
+      _parent->write_elements(os, _left_mults);
+      _parent->write_elements(os, _left_mults_inv);
+      _parent->write_elements(os, _left_reps);
+      _parent->write_elements(os, _right_mults);
+      _parent->write_elements(os, _right_mults_inv);
+      _parent->write_elements(os, _right_reps);
+      _parent->write_elements(os, _H_class);
+    }
+
+    // Reads the frame written by write, which is then considered to be
+    // computed.
+    void read_frame(std::istream& is) {
+      konieczny_type::read_indices(is, _left_indices);
+      konieczny_type::read_indices(is, _right_indices);
+      read_elements(is, _left_mults);
+      read_elements(is, _left_mults_inv);
+      read_elements(is, _left_reps);
+      read_elements(is, _right_mults);
+      read_elements(is, _right_mults_inv);
+      read_elements(is, _right_reps);
+      read_elements(is, _H_class);
+
+      size_t const nr_l = _left_indices.size();
+      size_t const nr_r = _right_indices.size();
+      if (nr_l == 0 || nr_r == 0 || _H_class.empty()
+          || _left_mults.size() != nr_l || _left_mults_inv.size() != nr_l
+          || _left_reps.size() != nr_l || _right_mults.size() != nr_r
+          || _right_mults_inv.size() != nr_r || _right_reps.size() != nr_r) {
+        LIBSEMIGROUPS_EXCEPTION("invalid input, inconsistent D-class frame");
+      }
+      for (lambda_orb_index_type i : _left_indices) {
+        if (i >= _parent->_lambda_orb.current_size()) {
+          LIBSEMIGROUPS_EXCEPTION("invalid input, lambda-value index %llu out "
+                                  "of range",
+                                  uint64_t(i));
+        }
+      }
+      for (rho_orb_index_type i : _right_indices) {
+        if (i >= _parent->_rho_orb.current_size()) {
+          LIBSEMIGROUPS_EXCEPTION("invalid input, rho-value index %llu out "
+                                  "of range",
+                                  uint64_t(i));
+        }
+      }
+      _class_computed   = true;
+      _H_class_computed = true;
+      _mults_computed   = true;
+      _reps_computed    = true;
+    }
+
+    void read_elements(std::istream&                       is,
+                       std::vector<internal_element_type>& v) {
+      uint64_t const n = konieczny_type::read_integer(is);
+      for (uint64_t i = 0; i < n; ++i) {
+        element_type x = konieczny_type::read_element(is);
+        _parent->validate_element(x);
+        v.push_back(frame_copy(this->to_internal_const(x)));
+      }
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // DClass - containment - protected
     ////////////////////////////////////////////////////////////////////////
@@ -2063,7 +2780,7 @@ namespace libsemigroups {
     }
 
     void push_left_mult(internal_const_reference x) {
-      _left_mults.push_back(this->internal_copy(x));
+      _left_mults.push_back(frame_copy(x));
 #ifdef LIBSEMIGROUPS_DEBUG
       PoolGuard             cg1(_parent->element_pool());
       PoolGuard             cg2(_parent->element_pool());
@@ -2091,7 +2808,7 @@ namespace libsemigroups {
     }
 
     void push_left_mult_inv(internal_const_reference x) {
-      _left_mults_inv.push_back(this->internal_copy(x));
+      _left_mults_inv.push_back(frame_copy(x));
 #ifdef LIBSEMIGROUPS_DEBUG
       PoolGuard             cg1(_parent->element_pool());
       PoolGuard             cg2(_parent->element_pool());
@@ -2118,7 +2835,7 @@ namespace libsemigroups {
     }
 
     void push_right_mult(internal_const_reference x) {
-      _right_mults.push_back(this->internal_copy(x));
+      _right_mults.push_back(frame_copy(x));
 #ifdef LIBSEMIGROUPS_DEBUG
       PoolGuard             cg1(_parent->element_pool());
       PoolGuard             cg2(_parent->element_pool());
@@ -2146,7 +2863,7 @@ namespace libsemigroups {
     }
 
     void push_right_mult_inv(internal_const_reference x) {
-      _right_mults_inv.push_back(this->internal_copy(x));
+      _right_mults_inv.push_back(frame_copy(x));
 #ifdef LIBSEMIGROUPS_DEBUG
       PoolGuard             cg1(_parent->element_pool());
       PoolGuard             cg2(_parent->element_pool());
@@ -2173,7 +2890,7 @@ namespace libsemigroups {
     }
 
     void push_left_rep(internal_const_reference x) {
-      _left_reps.push_back(this->internal_copy(x));
+      _left_reps.push_back(frame_copy(x));
 #ifdef LIBSEMIGROUPS_DEBUG
       PoolGuard             cg1(_parent->element_pool());
       internal_element_type tmp = cg1.get();
@@ -2195,7 +2912,7 @@ namespace libsemigroups {
     }
 
     void push_right_rep(internal_const_reference x) {
-      _right_reps.push_back(this->internal_copy(x));
+      _right_reps.push_back(frame_copy(x));
 #ifdef LIBSEMIGROUPS_DEBUG
       PoolGuard             cg1(_parent->element_pool());
       internal_element_type tmp = cg1.get();
@@ -2252,11 +2969,17 @@ namespace libsemigroups {
       return _parent;
     }
 
-    // Watch out! Doesn't copy its argument
+    // Watch out! Doesn't copy its argument, which should be owned by
+    // the arena of this, i.e. returned by frame_copy.
     void push_back_H_class(internal_element_type x) {
       _H_class.push_back(x);
     }
 
+    // Returns a copy of x that is freed when this is destroyed.
+    internal_element_type frame_copy(internal_const_reference x) {
+      return _arena.copy(x);
+    }
+
     std::vector<internal_element_type>& H_class() {
       return _H_class;
     }
@@ -2401,6 +3124,7 @@ namespace libsemigroups {
     ////////////////////////////////////////////////////////////////////////
     // DClass - data - private
     ////////////////////////////////////////////////////////////////////////
+    FrameArena                                 _arena;
     bool                                       _class_computed;
     std::vector<internal_element_type>         _H_class;
     bool                                       _H_class_computed;
@@ -2464,6 +3188,7 @@ namespace libsemigroups {
         typename std::vector<lambda_orb_index_type>::const_iterator;
     using const_internal_iterator =
         typename std::vector<internal_element_type>::const_iterator;
+    using H_group_tag = std::integral_constant<bool, H_group_helper::value>;
 
     ////////////////////////////////////////////////////////////////////////
     // RegularDClass - constructor - private
@@ -2507,8 +3232,12 @@ namespace libsemigroups {
     // represented by \p parent but is not regular.
     RegularDClass(Konieczny* parent, internal_reference rep)
         : Konieczny::DClass(parent, rep),
+          _H_class_listed(),
           _H_gens(),
           _H_gens_computed(false),
+          _H_group(nullptr),
+          _H_group_mtx(),
+          _H_group_size(0),
           _idem_reps_computed(false),
           _lambda_index_positions(),
           _left_idem_reps(),
@@ -2529,15 +3258,48 @@ namespace libsemigroups {
 #endif
     }
 
+    // Construct from a pointer to a Konieczny object, an idempotent
+    // representative, and the remainder of the frame as written by write;
+    // used by Konieczny::load. The representative is owned as in the other
+    // constructor, and _H_gens is left empty since it is only used to compute
+    // the H-class, which is read.
+    RegularDClass(Konieczny* parent, internal_reference rep, std::istream& is)
+        : Konieczny::DClass(parent, rep),
+          _H_class_listed(),
+          _H_gens(),
+          _H_gens_computed(true),
+          _H_group(nullptr),
+          _H_group_mtx(),
+          _H_group_size(0),
+          _idem_reps_computed(true),
+          _lambda_index_positions(),
+          _left_idem_reps(),
+          _left_indices_computed(true),
+          _rho_index_positions(),
+          _right_idem_reps(),
+          _right_indices_computed(true) {
+      if (!parent->is_regular_element_NC(rep)) {
+        LIBSEMIGROUPS_EXCEPTION("invalid input, the representative of a "
+                                "regular D-class is not regular");
+      }
+      this->read_frame(is);
+      this->read_elements(is, _left_idem_reps);
+      this->read_elements(is, _right_idem_reps);
+      for (size_t i = 0; i < this->left_indices().size(); ++i) {
+        _lambda_index_positions.emplace(this->left_indices()[i], i);
+      }
+      for (size_t i = 0; i < this->right_indices().size(); ++i) {
+        _rho_index_positions.emplace(this->right_indices()[i], i);
+      }
+    }
+
    public:
     ////////////////////////////////////////////////////////////////////////
     // RegularDClass - destructor - public
     ////////////////////////////////////////////////////////////////////////
-    virtual ~RegularDClass() {
-      // _H_gens is contained in _H_class which is freed in ~DClass
-      InternalVecFree()(_left_idem_reps);
-      InternalVecFree()(_right_idem_reps);
-    }
+    // The elements of _H_gens, _left_idem_reps, and _right_idem_reps are
+    // freed by the arena of DClass.
+    virtual ~RegularDClass() = default;
 
     ////////////////////////////////////////////////////////////////////////
     // RegularDClass - member functions - public
@@ -2568,13 +3330,23 @@ namespace libsemigroups {
       Product()(this->to_external(tmp2),
                 this->to_external_const(this->right_mults_inv(r_it->second)),
                 this->to_external(tmp1));
-      std::sort(this->H_class().begin(), this->H_class().end(), InternalLess());
+      if (_H_group != nullptr) {
+        return H_group_contains(tmp2, H_group_tag());
+      }
+      // H_class() was sorted in init()
       return std::binary_search(this->H_class().cbegin(),
                                 this->H_class().cend(),
                                 tmp2,
                                 InternalLess());
     }
 
+    size_t size_H_class() const override {
+      if (_H_group != nullptr) {
+        return _H_group_size;
+      }
+      return DClass::size_H_class();
+    }
+
     size_t number_of_idempotents() const override {
       size_t count = 0;
       for (auto it = cbegin_left_idem_reps(); it < cend_left_idem_reps();
@@ -2619,18 +3391,21 @@ namespace libsemigroups {
     //
     // Returns the indices of the L- and R-classes  that \p bm is in,
     // unless bm is not , in which case returns the pair (UNDEFINED,
-    // UNDEFINED). Requires computing part of the frame.
+    // UNDEFINED). Requires computing part of the frame. This is called on
+    // D-classes other than the one being computed, and so uses the workspace
+    // of the calling thread rather than the temporary values of \c this.
     std::pair<lambda_orb_index_type, rho_orb_index_type>
     index_positions(const_reference bm) {
       compute_left_indices();
       compute_right_indices();
-      Lambda()(this->tmp_lambda_value(), bm);
+      Workspace& ws = this->parent()->workspace();
+      Lambda()(ws._tmp_lambda_value1, bm);
       auto l_it = _lambda_index_positions.find(
-          this->parent()->_lambda_orb.position(this->tmp_lambda_value()));
+          this->parent()->_lambda_orb.position(ws._tmp_lambda_value1));
       if (l_it != _lambda_index_positions.end()) {
-        Rho()(this->tmp_rho_value(), bm);
+        Rho()(ws._tmp_rho_value1, bm);
         auto r_it = _rho_index_positions.find(
-            this->parent()->_rho_orb.position(this->tmp_rho_value()));
+            this->parent()->_rho_orb.position(ws._tmp_rho_value1));
         if (r_it != _rho_index_positions.end()) {
           return std::make_pair(l_it->second, r_it->second);
         }
@@ -2874,7 +3649,7 @@ namespace libsemigroups {
                       this->to_external(tmp1),
                       this->to_external_const(this->internal_vec()[j]));
             if (this->internal_set().find(tmp2) == this->internal_set().end()) {
-              internal_element_type x = this->internal_copy(tmp2);
+              internal_element_type x = this->frame_copy(tmp2);
               this->internal_set().insert(x);
               _H_gens.push_back(x);
             }
@@ -2918,7 +3693,7 @@ namespace libsemigroups {
             this->to_external_const(tmp1));
         this->parent()->idem_in_H_class(tmp3, tmp2);
 
-        _left_idem_reps.push_back(this->internal_copy(tmp3));
+        _left_idem_reps.push_back(this->frame_copy(tmp3));
       }
 
       for (auto rmult_it = this->cbegin_right_mults();
@@ -2939,13 +3714,27 @@ namespace libsemigroups {
 
         this->parent()->idem_in_H_class(tmp3, tmp2);
 
-        _right_idem_reps.push_back(this->internal_copy(tmp3));
+        _right_idem_reps.push_back(this->frame_copy(tmp3));
       }
       this->_idem_reps_computed = true;
     }
 
-    // there should be some way of getting rid of this
     void compute_H_class() override {
+      if (_H_group != nullptr) {
+        // The H-class is only listed when it is first required, which may
+        // happen in several threads at once, see add_D_classes_concurrently.
+        std::call_once(_H_class_listed, [this]() {
+          list_H_class();
+          std::sort(
+              this->H_class().begin(), this->H_class().end(), InternalLess());
+        });
+      } else {
+        list_H_class();
+      }
+    }
+
+    // there should be some way of getting rid of this
+    void list_H_class() {
       if (this->H_class_computed()) {
         return;
       }
@@ -2969,7 +3758,7 @@ namespace libsemigroups {
                     this->to_external_const(this->H_class_NC(i)),
                     this->to_external_const(g));
           if (this->internal_set().find(tmp) == this->internal_set().end()) {
-            internal_element_type x = this->internal_copy(tmp);
+            internal_element_type x = this->frame_copy(tmp);
             this->internal_set().insert(x);
             this->push_back_H_class(x);
           }
@@ -2988,10 +3777,64 @@ namespace libsemigroups {
       compute_reps();
       compute_idem_reps();
       compute_H_gens();
-      compute_H_class();
+      if (this->parent()->_use_schreier_sims) {
+        compute_H_group(H_group_tag());
+      } else {
+        compute_H_class();
+        // sorted here once so that contains can be called concurrently
+        std::sort(
+            this->H_class().begin(), this->H_class().end(), InternalLess());
+      }
       this->set_class_computed(true);
     }
 
+    ////////////////////////////////////////////////////////////////////////
+    // RegularDClass - stabilizer chains - private
+    ////////////////////////////////////////////////////////////////////////
+
+    // Represents the H-class of the idempotent rep by the stabilizer chain of
+    // the permutations corresponding to _H_gens.
+    void compute_H_group(std::true_type) {
+      _H_group = std::make_unique<H_group_type>();
+      typename GroupHClassPerm::type p;
+      for (internal_const_reference g : _H_gens) {
+        GroupHClassPerm()(p, this->rep(), this->to_external_const(g));
+        _H_group->add_generator(p);
+      }
+      _H_group_size = _H_group->size();
+    }
+
+    void compute_H_group(std::false_type) {
+      // use_schreier_sims(true) throws for such element types
+      LIBSEMIGROUPS_ASSERT(false);
+    }
+
+    // Returns whether x, which belongs to the H-class of rep if it belongs to
+    // this, belongs to the H-class of rep.
+    bool H_group_contains(internal_const_reference x, std::true_type) {
+      typename GroupHClassPerm::type p;
+      GroupHClassPerm()(p, this->rep(), this->to_external_const(x));
+      // SchreierSims::contains modifies the SchreierSims object
+      std::lock_guard<std::mutex> lg(_H_group_mtx);
+      return _H_group->contains(p);
+    }
+
+    bool H_group_contains(internal_const_reference, std::false_type) {
+      LIBSEMIGROUPS_ASSERT(false);
+      return false;
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    // RegularDClass - serialization member functions - private
+    ////////////////////////////////////////////////////////////////////////
+    // Writes the frame of this as DClass::write does, followed by the
+    // idempotent representatives.
+    void write(std::ostream& os) const {
+      DClass::write(os);
+      this->parent()->write_elements(os, _left_idem_reps);
+      this->parent()->write_elements(os, _right_idem_reps);
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // RegularDClass - accessor member functions - private (friend NonRegular)
     ////////////////////////////////////////////////////////////////////////
@@ -3018,8 +3861,12 @@ namespace libsemigroups {
     ////////////////////////////////////////////////////////////////////////
     // RegularDClass - data - private
     ////////////////////////////////////////////////////////////////////////
+    std::once_flag                     _H_class_listed;
     std::vector<internal_element_type> _H_gens;
     bool                               _H_gens_computed;
+    std::unique_ptr<H_group_type>      _H_group;
+    std::mutex                         _H_group_mtx;
+    uint64_t                           _H_group_size;
     bool                               _idem_reps_computed;
     std::unordered_map<lambda_orb_index_type, left_indices_index_type>
                                        _lambda_index_positions;
@@ -3123,16 +3970,50 @@ namespace libsemigroups {
       init();
     }
 
+    // Construct from a pointer to a Konieczny object, a representative, and
+    // the remainder of the frame as written by write; used by
+    // Konieczny::load. The idempotents above this are not recorded, since
+    // they are only used to compute the frame.
+    NonRegularDClass(Konieczny*         parent,
+                     internal_reference rep,
+                     std::istream&      is)
+        : Konieczny::DClass(parent, rep),
+          _H_set(),
+          _idems_above_computed(true),
+          _lambda_index_positions(),
+          _left_idem_above(rep),
+          _left_idem_class(nullptr),
+          _left_idem_H_class(),
+          _left_idem_left_reps(),
+          _left_indices_computed(true),
+          _rho_index_positions(),
+          _right_idem_above(rep),
+          _right_idem_class(nullptr),
+          _right_idem_H_class(),
+          _right_idem_right_reps(),
+          _right_indices_computed(true) {
+      if (parent->is_regular_element_NC(rep)) {
+        LIBSEMIGROUPS_EXCEPTION("invalid input, the representative of a "
+                                "non-regular D-class is regular");
+      }
+      this->read_frame(is);
+      for (size_t i = 0; i < this->left_indices().size(); ++i) {
+        _lambda_index_positions[this->left_indices()[i]].push_back(i);
+      }
+      for (size_t i = 0; i < this->right_indices().size(); ++i) {
+        _rho_index_positions[this->right_indices()[i]].push_back(i);
+      }
+      construct_H_set();
+    }
+
    public:
     ////////////////////////////////////////////////////////////////////////
     // NonRegularDClass - destructor - public
     ////////////////////////////////////////////////////////////////////////
-    virtual ~NonRegularDClass() {
-      InternalVecFree()(_left_idem_H_class);
-      InternalVecFree()(_right_idem_H_class);
-      InternalVecFree()(_left_idem_left_reps);
-      InternalVecFree()(_right_idem_right_reps);
-    }
+    // The elements of _left_idem_H_class, _right_idem_H_class,
+    // _left_idem_left_reps, and _right_idem_right_reps are freed by the arena
+    // of DClass.
+    virtual ~NonRegularDClass() = default;
 
     ////////////////////////////////////////////////////////////////////////
     // NonRegularDClass - member functions - public
@@ -3296,7 +4177,7 @@ namespace libsemigroups {
         Product()(this->to_external(tmp2),
                   this->to_external(tmp1),
                   this->to_external_const(left_idem_left_mult));
-        _left_idem_H_class.push_back(this->internal_copy(tmp2));
+        _left_idem_H_class.push_back(this->frame_copy(tmp2));
       }
 
       for (auto it = _right_idem_class->cbegin_H_class();
@@ -3308,7 +4189,7 @@ namespace libsemigroups {
         Product()(this->to_external(tmp2),
                   this->to_external(tmp1),
                   this->to_external_const(right_idem_left_mult));
-        _right_idem_H_class.push_back(this->internal_copy(tmp2));
+        _right_idem_H_class.push_back(this->frame_copy(tmp2));
       }
 
       for (auto it = _left_idem_class->cbegin_left_mults();
@@ -3320,7 +4201,7 @@ namespace libsemigroups {
         Product()(this->to_external(tmp2),
                   this->to_external(tmp1),
                   this->to_external_const(*it));
-        _left_idem_left_reps.push_back(this->internal_copy((tmp2)));
+        _left_idem_left_reps.push_back(this->frame_copy(tmp2));
       }
 
       for (auto it = _right_idem_class->cbegin_right_mults();
@@ -3332,11 +4213,11 @@ namespace libsemigroups {
         Product()(this->to_external(tmp2),
                   this->to_external(tmp1),
                   this->to_external_const(right_idem_left_mult));
-        _right_idem_right_reps.push_back(this->internal_copy(tmp2));
+        _right_idem_right_reps.push_back(this->frame_copy(tmp2));
       }
 
-      static std::vector<internal_element_type> Hex;
-      static std::vector<internal_element_type> xHf;
+      static thread_local std::vector<internal_element_type> Hex;
+      static thread_local std::vector<internal_element_type> xHf;
 
       for (internal_const_reference s : _left_idem_H_class) {
         Product()(
@@ -3350,7 +4231,6 @@ namespace libsemigroups {
         Hex.push_back(this->internal_copy(tmp1));
       }
 
-      static internal_set_type s;
       this->internal_set().clear();
       for (auto it = Hex.begin(); it < Hex.end(); ++it) {
         if (!this->internal_set().insert(*it).second) {
@@ -3383,7 +4263,7 @@ namespace libsemigroups {
       for (auto it = this->internal_vec().cbegin();
            it < this->internal_vec().cend();
            ++it) {
-        this->push_back_H_class(this->internal_copy(*it));
+        this->push_back_H_class(this->frame_copy(*it));
       }
 
       InternalVecFree()(xHf);
@@ -3416,28 +4296,28 @@ namespace libsemigroups {
       internal_const_element_type right_idem_right_mult
           = _right_idem_class->cbegin_right_mults()[right_idem_indices.second];
 
-      static std::unordered_set<
+      static thread_local std::unordered_set<
           std::vector<internal_element_type>,
           Hash<std::vector<internal_element_type>, InternalHash>,
           InternalVecEqualTo>
           Hxhw_set;
       Hxhw_set.clear();
 
-      static std::unordered_set<
+      static thread_local std::unordered_set<
           std::vector<internal_element_type>,
           Hash<std::vector<internal_element_type>, InternalHash>,
           InternalVecEqualTo>
           Hxh_set;
       Hxh_set.clear();
 
-      static std::unordered_set<
+      static thread_local std::unordered_set<
           std::vector<internal_element_type>,
           Hash<std::vector<internal_element_type>, InternalHash>,
           InternalVecEqualTo>
           zhHx_set;
       zhHx_set.clear();
 
-      static std::unordered_set<
+      static thread_local std::unordered_set<
           std::vector<internal_element_type>,
           Hash<std::vector<internal_element_type>, InternalHash>,
           InternalVecEqualTo>
@@ -3453,7 +4333,7 @@ namespace libsemigroups {
       auto      tmp3 = cg3.get();
       auto      tmp4 = cg4.get();
       for (internal_const_reference h : _left_idem_H_class) {
-        static std::vector<internal_element_type> Hxh;
+        static thread_local std::vector<internal_element_type> Hxh;
         LIBSEMIGROUPS_ASSERT(Hxh.empty());
         for (auto it = this->cbegin_H_class(); it < this->cend_H_class();
              ++it) {
@@ -3466,7 +4346,7 @@ namespace libsemigroups {
         std::sort(Hxh.begin(), Hxh.end(), InternalLess());
         if (Hxh_set.find(Hxh) == Hxh_set.end()) {
           for (size_t i = 0; i < _left_idem_left_reps.size(); ++i) {
-            static std::vector<internal_element_type> Hxhw;
+            static thread_local std::vector<internal_element_type> Hxhw;
             Hxhw.clear();
 
             for (auto it = Hxh.cbegin(); it < Hxh.cend(); ++it) {
@@ -3542,7 +4422,7 @@ namespace libsemigroups {
       }
 
       for (internal_const_reference h : _right_idem_H_class) {
-        static std::vector<internal_element_type> hHx;
+        static thread_local std::vector<internal_element_type> hHx;
         LIBSEMIGROUPS_ASSERT(hHx.empty());
 
         for (auto it = this->cbegin_H_class(); it < this->cend_H_class();
@@ -3556,7 +4436,7 @@ namespace libsemigroups {
         std::sort(hHx.begin(), hHx.end(), InternalLess());
         if (hHx_set.find(hHx) == hHx_set.end()) {
           for (size_t i = 0; i < _right_idem_right_reps.size(); ++i) {
-            static std::vector<internal_element_type> zhHx;
+            static thread_local std::vector<internal_element_type> zhHx;
             zhHx.clear();
             for (auto it = hHx.cbegin(); it < hHx.cend(); ++it) {
               Product()(this->to_external(tmp1),
@@ -3756,6 +4636,169 @@ namespace libsemigroups {
   }
 #endif
 
+  template <typename TElementType, typename TTraits>
+  void Konieczny<TElementType, TTraits>::save(std::ostream& os) {
+    os.write(detail::KONIECZNY_MAGIC, 8);
+    write_integer(os, detail::KONIECZNY_VERSION);
+    write_integer(os, sizeof(element_type));
+    // _one is the last entry of _gens once the data is initialised
+    size_t const nr_gens = _gens.size() - (_data_initialised ? 1 : 0);
+    write_integer(os, nr_gens);
+    for (size_t i = 0; i < nr_gens; ++i) {
+      write_element(os, this->to_external_const(_gens[i]));
+    }
+    write_integer(os, _run_initialised);
+    if (!_run_initialised) {
+      return;
+    }
+    // The orbits are recomputed by load, their sizes are only written to check
+    // that the recomputed orbits are the same.
+    write_integer(os, _lambda_orb.current_size());
+    write_integer(os, _rho_orb.current_size());
+    write_integer(os, _adjoined_identity_contained);
+    write_integer(os, _reps_processed);
+    write_integer(os, _D_classes.size());
+    for (DClass* D : _D_classes) {
+      // the H-class may not have been listed, see use_schreier_sims
+      D->compute_H_class();
+      write_integer(os, D->is_regular_D_class());
+      write_element(os, D->rep());
+      if (D->is_regular_D_class()) {
+        static_cast<RegularDClass const*>(D)->write(os);
+      } else {
+        D->write(os);
+      }
+    }
+    for (auto const& rels : _D_rels) {
+      write_indices(os, rels);
+    }
+    write_integer(os, _ranks.size());
+    for (rank_type rnk : _ranks) {
+      write_integer(os, rnk);
+      for (auto const* reps : {&_reg_reps[rnk], &_nonregular_reps[rnk]}) {
+        write_integer(os, reps->size());
+        for (auto const& x : *reps) {
+          write_element(os, this->to_external_const(x.first));
+          write_integer(os, x.second);
+        }
+      }
+    }
+  }
+
+  template <typename TElementType, typename TTraits>
+  void Konieczny<TElementType, TTraits>::load(std::istream& is) {
+    if (!_gens.empty()) {
+      LIBSEMIGROUPS_EXCEPTION("cannot load into a Konieczny instance "
+                              "which has generators");
+    }
+    char magic[8];
+    if (!is.read(magic, 8)
+        || !std::equal(magic, magic + 8, detail::KONIECZNY_MAGIC)) {
+      LIBSEMIGROUPS_EXCEPTION("invalid input, not the output of "
+                              "Konieczny::save");
+    }
+    uint64_t const version = read_integer(is);
+    if (version != detail::KONIECZNY_VERSION) {
+      LIBSEMIGROUPS_EXCEPTION(
+          "invalid input, expected version %llu, found %llu",
+          uint64_t(detail::KONIECZNY_VERSION),
+          version);
+    }
+    uint64_t const elt_size = read_integer(is);
+    if (elt_size != sizeof(element_type)) {
+      LIBSEMIGROUPS_EXCEPTION("invalid input, expected elements of %llu "
+                              "bytes, found %llu",
+                              uint64_t(sizeof(element_type)),
+                              elt_size);
+    }
+    uint64_t const            nr_gens = read_integer(is);
+    std::vector<element_type> gens;
+    for (uint64_t i = 0; i < nr_gens; ++i) {
+      gens.push_back(read_element(is));
+    }
+    add_generators(gens.cbegin(), gens.cend());
+    if (!gens.empty()) {
+      // as in the constructor from generators
+      init_data();
+    }
+    if (!read_integer(is)) {
+      return;
+    }
+
+    init_data();
+    compute_orbs();
+    uint64_t const lambda_size = read_integer(is);
+    uint64_t const rho_size    = read_integer(is);
+    if (!_lambda_orb.finished() || !_rho_orb.finished()) {
+      LIBSEMIGROUPS_EXCEPTION("the lambda- and rho-orbits were not computed");
+    }
+    if (lambda_size != _lambda_orb.current_size()
+        || rho_size != _rho_orb.current_size()) {
+      LIBSEMIGROUPS_EXCEPTION("invalid input, expected orbits of sizes %llu "
+                              "and %llu, found %llu and %llu",
+                              lambda_size,
+                              rho_size,
+                              uint64_t(_lambda_orb.current_size()),
+                              uint64_t(_rho_orb.current_size()));
+    }
+    _adjoined_identity_contained = read_integer(is);
+    _reps_processed              = read_integer(is);
+
+    uint64_t const nr_D_classes = read_integer(is);
+    if (nr_D_classes == 0) {
+      LIBSEMIGROUPS_EXCEPTION("invalid input, no D-classes");
+    }
+    for (uint64_t i = 0; i < nr_D_classes; ++i) {
+      bool const   is_reg = read_integer(is);
+      element_type x      = read_element(is);
+      validate_element(x);
+      // the representative is owned by the D-class once it is constructed
+      internal_element_type rep
+          = this->internal_copy(this->to_internal_const(x));
+      if (is_reg) {
+        add_D_class(new RegularDClass(this, rep, is));
+      } else {
+        add_D_class(new NonRegularDClass(this, rep, is));
+      }
+    }
+    for (auto& rels : _D_rels) {
+      read_indices(is, rels);
+      for (D_class_index_type d : rels) {
+        if (d >= nr_D_classes) {
+          LIBSEMIGROUPS_EXCEPTION("invalid input, D-class index %llu out of "
+                                  "range",
+                                  uint64_t(d));
+        }
+      }
+    }
+
+    uint64_t const nr_ranks = read_integer(is);
+    for (uint64_t i = 0; i < nr_ranks; ++i) {
+      rank_type const rnk = read_integer(is);
+      if (rnk >= _reg_reps.size()) {
+        LIBSEMIGROUPS_EXCEPTION("invalid input, rank %llu out of range",
+                                uint64_t(rnk));
+      }
+      _ranks.insert(rnk);
+      for (auto* reps : {&_reg_reps[rnk], &_nonregular_reps[rnk]}) {
+        uint64_t const nr_reps = read_integer(is);
+        for (uint64_t j = 0; j < nr_reps; ++j) {
+          element_type x = read_element(is);
+          validate_element(x);
+          D_class_index_type const d = read_integer(is);
+          if (d >= nr_D_classes) {
+            LIBSEMIGROUPS_EXCEPTION("invalid input, D-class index %llu out of "
+                                    "range",
+                                    uint64_t(d));
+          }
+          reps->emplace_back(this->internal_copy(this->to_internal_const(x)),
+                             d);
+        }
+      }
+    }
+    _run_initialised = true;
+  }
+
   template <typename TElementType, typename TTraits>
   bool Konieczny<TElementType, TTraits>::finished_impl() const {
     return _ranks.empty() && _run_initialised;
@@ -3837,6 +4880,219 @@ namespace libsemigroups {
                    max_rank());
   }
 
+  template <typename TElementType, typename TTraits>
+  void Konieczny<TElementType, TTraits>::init_workspaces() {
+    if (_workspaces.empty()) {
+      // The multipliers of the orbits are cached the first time they are
+      // requested, and so we compute all of them here, before any other
+      // threads can request them.
+      for (size_t i = 0; i < _lambda_orb.current_size(); ++i) {
+        _lambda_orb.multiplier_to_scc_root(i);
+        _lambda_orb.multiplier_from_scc_root(i);
+      }
+      for (size_t i = 0; i < _rho_orb.current_size(); ++i) {
+        _rho_orb.multiplier_to_scc_root(i);
+        _rho_orb.multiplier_from_scc_root(i);
+      }
+    }
+    while (_workspaces.size() < _max_threads) {
+      _workspaces.emplace_back(new Workspace());
+      _workspaces.back()->init(this->to_external_const(_one));
+      _workspaces.back()->_element_pool.init(_one);
+    }
+  }
+
+  // Moves the group indices found by the threads into the cache of
+  // _workspace, which the threads also read from, so that the caches of the
+  // threads only contain the values found since they were last started.
+  template <typename TElementType, typename TTraits>
+  void Konieczny<TElementType, TTraits>::merge_group_indices() {
+    for (auto& ws : _workspaces) {
+      _workspace._group_indices.insert(ws->_group_indices.cbegin(),
+                                       ws->_group_indices.cend());
+      ws->_group_indices.clear();
+      _workspace._group_indices_rev.insert(ws->_group_indices_rev.cbegin(),
+                                           ws->_group_indices_rev.cend());
+      ws->_group_indices_rev.clear();
+    }
+  }
+
+  // Representatives in the same D-class have lambda-values in the same
+  // strongly connected component of _lambda_orb, and rho-values in the same
+  // strongly connected component of _rho_orb. Hence representatives for which
+  // these pairs of components differ belong to distinct D-classes, and we can
+  // compute these D-classes concurrently without producing duplicates.
+  template <typename TElementType, typename TTraits>
+  void Konieczny<TElementType, TTraits>::add_D_classes_concurrently(
+      std::vector<std::pair<internal_element_type, D_class_index_type>>&
+                 next_reps,
+      bool const reps_are_reg) {
+    using rep_type = std::pair<internal_element_type, D_class_index_type>;
+    using key_type
+        = std::pair<lambda_orb_scc_index_type, rho_orb_scc_index_type>;
+    using cover_type = std::tuple<internal_element_type, rank_type, bool>;
+
+    init_workspaces();
+
+    std::unordered_set<key_type, PairHash> keys;
+    std::vector<rep_type>                  batch;
+    std::vector<rep_type>                  rest;
+    std::vector<DClass*>                   found;
+    std::vector<std::vector<cover_type>>   covers;
+
+    while (next_reps.size() > 1) {
+      run_report();
+      keys.clear();
+      batch.clear();
+      rest.clear();
+      for (auto& x : next_reps) {
+        Lambda()(_workspace._tmp_lambda_value1,
+                 this->to_external_const(x.first));
+        Rho()(_workspace._tmp_rho_value1, this->to_external_const(x.first));
+        key_type key(_lambda_orb.digraph().scc_id(
+                         _lambda_orb.position(_workspace._tmp_lambda_value1)),
+                     _rho_orb.digraph().scc_id(
+                         _rho_orb.position(_workspace._tmp_rho_value1)));
+        if (keys.insert(key).second) {
+          batch.push_back(x);
+        } else {
+          rest.push_back(x);
+        }
+      }
+
+      found.assign(batch.size(), nullptr);
+      covers.assign(batch.size(), std::vector<cover_type>());
+      std::atomic<size_t> next(0);
+
+      auto worker = [&](size_t t) {
+        _thread_workspace = _workspaces[t].get();
+        for (size_t i = next++; i < batch.size(); i = next++) {
+          DClass* D;
+          if (reps_are_reg) {
+            D = new RegularDClass(this, batch[i].first);
+          } else {
+            D = new NonRegularDClass(this, batch[i].first);
+          }
+          for (internal_reference x : D->covering_reps()) {
+            rank_type rnk
+                = InternalRank()(_rank_state, this->to_external_const(x));
+            covers[i].emplace_back(x, rnk, is_regular_element_NC(x));
+          }
+          found[i] = D;
+        }
+        _thread_workspace = nullptr;
+      };
+
+      size_t const nr_threads = std::min(_max_threads, batch.size());
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < nr_threads; ++t) {
+        threads.emplace_back(worker, t);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+
+      merge_group_indices();
+
+      for (size_t i = 0; i < batch.size(); ++i) {
+        if (reps_are_reg) {
+          add_D_class(static_cast<RegularDClass*>(found[i]));
+        } else {
+          add_D_class(static_cast<NonRegularDClass*>(found[i]));
+        }
+        for (auto& x : covers[i]) {
+          rank_type const rnk = std::get<1>(x);
+          _ranks.insert(rnk);
+          if (std::get<2>(x)) {
+            _reg_reps[rnk].emplace_back(std::get<0>(x), _D_classes.size() - 1);
+          } else {
+            _nonregular_reps[rnk].emplace_back(std::get<0>(x),
+                                               _D_classes.size() - 1);
+          }
+        }
+        _reps_processed++;
+      }
+
+      next_reps.clear();
+      for (auto& x : rest) {
+        D_class_index_type i = get_containing_D_class(x.first);
+        if (i != UNDEFINED) {
+          _D_rels[i].push_back(x.second);
+          this->internal_free(x.first);
+          _reps_processed++;
+        } else {
+          next_reps.push_back(x);
+        }
+      }
+    }
+  }
+
+  template <typename TElementType, typename TTraits>
+  template <typename T>
+  std::vector<bool>
+  Konieczny<TElementType, TTraits>::test_elements(T          first,
+                                                  T          last,
+                                                  bool const regular) {
+    run();
+    size_t const      n = std::distance(first, last);
+    std::vector<bool> result;
+    result.reserve(n);
+    if (!finished()) {
+      // only possible if this was killed, in which case the D-classes may be
+      // incomplete and the elements cannot be tested.
+      LIBSEMIGROUPS_EXCEPTION(
+          "the algorithm did not finish, the elements cannot be tested");
+    }
+
+    auto test = [this, regular](const_reference x) -> bool {
+      if (Degree()(x) != degree()) {
+        return false;
+      }
+      internal_const_element_type y = this->to_internal_const(x);
+      return find_D_class(y, true) != UNDEFINED
+             && (!regular || is_regular_element_NC(y));
+    };
+
+    size_t const nr_threads = std::min(_max_threads, n);
+    if (nr_threads <= 1) {
+      for (auto it = first; it != last; ++it) {
+        result.push_back(test(*it));
+      }
+      return result;
+    }
+
+    init_workspaces();
+    // Each thread tests a contiguous part of the range, and writes to its
+    // own vector, since distinct entries of a std::vector<bool> may share a
+    // word.
+    std::vector<std::vector<bool>> parts(nr_threads);
+    auto worker = [&](size_t t, T it, size_t len) {
+      _thread_workspace = _workspaces[t].get();
+      parts[t].reserve(len);
+      for (size_t i = 0; i < len; ++i, ++it) {
+        parts[t].push_back(test(*it));
+      }
+      _thread_workspace = nullptr;
+    };
+
+    std::vector<std::thread> threads;
+    size_t const             q = n / nr_threads;
+    size_t const             r = n % nr_threads;
+    for (size_t t = 0; t < nr_threads; ++t) {
+      size_t const len = q + (t < r ? 1 : 0);
+      threads.emplace_back(worker, t, first, len);
+      std::advance(first, len);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    merge_group_indices();
+    for (auto const& part : parts) {
+      result.insert(result.end(), part.cbegin(), part.cend());
+    }
+    return result;
+  }
+
   template <typename TElementType, typename TTraits>
   void Konieczny<TElementType, TTraits>::run_impl() {
     detail::Timer t;
@@ -3878,6 +5134,10 @@ namespace libsemigroups {
       }
       std::swap(next_reps, tmp_next);
 
+      if (_max_threads > 1) {
+        add_D_classes_concurrently(next_reps, reps_are_reg);
+      }
+
       while (!next_reps.empty()) {
         run_report();
         auto& tup = next_reps.back();
@@ -690,7 +690,8 @@ namespace libsemigroups {
         // set up the strong generators
         for (index_type j = first; j < _strong_gens.size(i - 1); j++) {
           internal_element_type x = _strong_gens.at(i - 1, j);
-          if (beta == Action()(beta, this->to_external_const(x))) {
+          if (beta == Action()(beta, this->to_external_const(x))
+              && !has_strong_generator(i, x)) {
             _strong_gens.push_back(i, x);
           }
         }
@@ -748,6 +749,19 @@ namespace libsemigroups {
       _finished = true;
     }
 
+    // When schreier_sims is rerun after add_generator, every generator on
+    // level 0 is considered again, and so this is used to avoid storing a
+    // strong generator twice (and overflowing _strong_gens).
+    bool has_strong_generator(index_type depth, internal_const_element_type x) {
+      for (auto it = _strong_gens.cbegin(depth); it < _strong_gens.cend(depth);
+           ++it) {
+        if (InternalEqualTo()(*it, x)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
     typename domain_type::const_iterator
     first_non_fixed_point(internal_const_element_type x) {
       for (auto it = _domain.cbegin(); it < _domain.cend(); ++it) {
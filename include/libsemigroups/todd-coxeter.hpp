@@ -22,6 +22,7 @@
 #ifndef LIBSEMIGROUPS_TODD_COXETER_HPP_
 #define LIBSEMIGROUPS_TODD_COXETER_HPP_
 
+#include <algorithm>   // for min
 #include <chrono>      // for chrono::nanoseconds
 #include <cstddef>     // for size_t
 #include <functional>  // for function
@@ -33,7 +34,7 @@
 
 #include "cong-intf.hpp"   // for congruence_kind,...
 #include "cong-wrap.hpp"   // for CongruenceWrapper
-#include "containers.hpp"  // for DynamicArray2
+#include "containers.hpp"  // for DynamicArray2, CopyOnWriteArray2
 #include "coset.hpp"       // for CosetManager
 #include "debug.hpp"       // for LIBSEMIGROUPS_ASSERT
 #include "int-range.hpp"   // for IntegralRange
@@ -42,6 +43,7 @@
 #include "report.hpp"      // for REPORT
 #include "string.hpp"      // for to_string
 #include "types.hpp"       // for word_type, letter_type...
+#include "uf.hpp"          // for Duf
 
 namespace libsemigroups {
   // Forward declarations
@@ -204,7 +206,18 @@ namespace libsemigroups {
           //!
           //! and this strategy is then run for approximately the amount
           //! of time specified by the setting random_interval(T).
-          random
+          random,
+          //! This value indicates that the HLT and Felsch strategies should
+          //! be combined adaptively. Each strategy is run for approximately
+          //! the amount of time specified by the setting random_interval(T),
+          //! and then the number of cosets defined and killed, the proportion
+          //! of the coset table that is filled, and the size of the deduction
+          //! stack, in that interval, are used to choose the strategy, type of
+          //! lookahead, deduction processing, and lookahead threshold for the
+          //! next interval. The values of lookahead(), next_lookahead(), and
+          //! save() set before the enumeration are restored when it
+          //! finishes or is stopped.
+          adaptive
         };
 
         //! Values for specifying the type of lookahead to perform.
@@ -332,6 +345,30 @@ namespace libsemigroups {
       //!
       //! \exceptions
       //! \no_libsemigroups_except
+      //!
+      //! \note
+      //! If \p p is options::froidure_pin::use_cayley_graph, then the rows of
+      //! the left or right Cayley graph of \p fp are not copied when the
+      //! coset table is prefilled, but are read from \p fp until they are
+      //! modified. The object pointed to by \p fp is kept alive for as long
+      //! as any row is borrowed in this way. Adding generators to \p fp
+      //! (using FroidurePin::add_generator or FroidurePin::closure, which
+      //! only append to the Cayley graphs) is supported, and the borrowed
+      //! rows are then copied the next time \ref run is called.
+      //! Standardizing the table, which happens the first time that a word
+      //! is converted to a class index or vice versa, does not copy the
+      //! borrowed rows.
+      //!
+      //! \note
+      //! Unless store_preimages(bool) is called with argument \c false
+      //! (which is only possible when using the HLT strategy), prefilling
+      //! still allocates and fills the preimages of the cosets, which use
+      //! twice as much memory as the coset table itself, see
+      //! store_preimages(bool).
+      //!
+      //! \warning
+      //! The existing entries of the Cayley graphs of \p fp must not be
+      //! modified in any other way while this is not finished.
       ToddCoxeter(congruence_kind                  knd,
                   std::shared_ptr<FroidurePinBase> fp,
                   options::froidure_pin            p
@@ -364,6 +401,13 @@ namespace libsemigroups {
       //!
       //! \exceptions
       //! \no_libsemigroups_except
+      //!
+      //! \note
+      //! If \p tc is finished, then the coset table is prefilled by
+      //! borrowing the rows of the left or right Cayley graph of
+      //! fpsemigroup::ToddCoxeter::froidure_pin, as described in
+      //! ToddCoxeter(congruence_kind, std::shared_ptr<FroidurePinBase>,
+      //! options::froidure_pin).
       ToddCoxeter(congruence_kind knd, fpsemigroup::ToddCoxeter& tc);
 
       //! Construct from kind (left/right/2-sided) and KnuthBendix.
@@ -376,6 +420,14 @@ namespace libsemigroups {
       //!
       //! \exceptions
       //! \no_libsemigroups_except
+      //!
+      //! \note
+      //! If \p kb is finished and the semigroup it represents is finite, then
+      //! the coset table is prefilled by borrowing the rows of the left or
+      //! right Cayley graph of fpsemigroup::KnuthBendix::froidure_pin, as
+      //! described in
+      //! ToddCoxeter(congruence_kind, std::shared_ptr<FroidurePinBase>,
+      //! options::froidure_pin).
       ToddCoxeter(congruence_kind knd, fpsemigroup::KnuthBendix& kb);
 
       //! Copy constructor.
@@ -430,6 +482,17 @@ namespace libsemigroups {
       //!
       //! \complexity
       //! Linear in the total number of entries in the table \p t.
+      //!
+      //! \note
+      //! The table \p t is copied, and so it can be modified or destroyed
+      //! after this function returns. This is unlike the prefilling from the
+      //! Cayley graph of a FroidurePin instance performed when \ref run is
+      //! first called on an object constructed using
+      //! ToddCoxeter(congruence_kind, std::shared_ptr<FroidurePinBase>,
+      //! options::froidure_pin), where the rows of the Cayley graph are
+      //! borrowed rather than copied. In both cases, the preimages of the
+      //! cosets are also allocated and filled, unless store_preimages(bool)
+      //! was called with argument \c false.
       void prefill(table_type const& t);
 
       // Settings
@@ -490,6 +553,20 @@ namespace libsemigroups {
       //! \sa ToddCoxeter::options::lookahead.
       ToddCoxeter& lookahead(options::lookahead val) noexcept;
 
+      //! The current type of lookahead.
+      //!
+      //! \parameters
+      //! (None)
+      //!
+      //! \returns
+      //! A value of type options::lookahead.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa lookahead(options::lookahead)
+      options::lookahead lookahead() const noexcept;
+
       //! Specify minimum number of classes that may trigger early stop.
       //!
       //! Set a lower bound for the number of classes of the congruence
@@ -527,6 +604,98 @@ namespace libsemigroups {
       //! \noexcept
       ToddCoxeter& next_lookahead(size_t val) noexcept;
 
+      //! The current threshold for the next lookahead.
+      //!
+      //! \parameters
+      //! (None)
+      //!
+      //! \returns
+      //! A value of type \c size_t.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa next_lookahead(size_t)
+      size_t next_lookahead() const noexcept;
+
+      //! Set the size of a collapse that triggers batch processing.
+      //!
+      //! If the number of pending coincidences exceeds the value set by this
+      //! function, then the remaining coincidences are not processed one at a
+      //! time. Instead, all of the coincidences (and any they imply) are first
+      //! collapsed to class representatives using a union-find data
+      //! structure, and then the coset table and its preimages are rewritten
+      //! in a single pass over the active cosets. This is typically much
+      //! faster when a lookahead causes a large proportion of the cosets to
+      //! be identified.
+      //!
+      //! The default value is 100,000.
+      //!
+      //! \param val value indicating the threshold.
+      //!
+      //! \returns A reference to `*this`.
+      //!
+      //! \exceptions
+      //! \noexcept
+      ToddCoxeter& large_collapse(size_t val) noexcept;
+
+      //! The current threshold for batch processing of coincidences.
+      //!
+      //! \parameters
+      //! (None)
+      //!
+      //! \returns
+      //! A value of type \c size_t.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa large_collapse(size_t)
+      size_t large_collapse() const noexcept;
+
+      //! Store the preimages of cosets during HLT.
+      //!
+      //! If the argument of this function is \c false, then the preimages of
+      //! the cosets are not stored during an enumeration using the HLT
+      //! strategy. Instead coincidences are queued, and processed in batches
+      //! by rescanning the entire coset table. If \f$n\f$ is the number of
+      //! generators, then every coset uses \f$n\f$ values of type
+      //! \ref class_index_type in the coset table, \f$2n\f$ for its
+      //! preimages (if they are stored), and \f$3\f$ for the list of
+      //! active cosets. On a 64-bit platform, this is \f$24n + 24\f$ bytes
+      //! per coset if preimages are stored, and \f$8n + 24\f$ bytes if they
+      //! are not. The preimages are rebuilt if they are required
+      //! later, for example, if \c this is run again after calling
+      //! store_preimages(bool) with argument \c true.
+      //!
+      //! The default value is \c true.
+      //!
+      //! \param val value indicating whether or not to store preimages.
+      //!
+      //! \returns A reference to `*this`.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \note If \p val is \c false, then running \c this throws a
+      //! LibsemigroupsException unless the strategy is options::strategy::hlt
+      //! and save() and standardize() are both \c false.
+      ToddCoxeter& store_preimages(bool val) noexcept;
+
+      //! Whether or not preimages are stored during HLT.
+      //!
+      //! \parameters
+      //! (None)
+      //!
+      //! \returns
+      //! A value of type \c bool.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa store_preimages(bool)
+      bool store_preimages() const noexcept;
+
       //! Process deductions during HLT.
       //!
       //! If the argument of this function is \c true and the HLT strategy is
@@ -546,6 +715,20 @@ namespace libsemigroups {
       //! options::froidure_pin::use_relations.
       ToddCoxeter& save(bool val);  // NOLINT()
 
+      //! Whether or not deductions are processed during HLT.
+      //!
+      //! \parameters
+      //! (None)
+      //!
+      //! \returns
+      //! A value of type \c bool.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa save(bool)
+      bool save() const noexcept;
+
       //! Short-lex standardize the table during enumeration.
       //!
       //! If the argument of this function is \c true, then the coset table is
@@ -565,7 +748,7 @@ namespace libsemigroups {
       //! Specify the strategy.
       //!
       //! The strategy used during the coset enumeration can be specified using
-      //! this function. It can be set to HLT, Felsch, or random.
+      //! this function. It can be set to HLT, Felsch, random, or adaptive.
       //!
       //! The default value is options::strategy::hlt.
       //!
@@ -574,6 +757,7 @@ namespace libsemigroups {
       //! * options::strategy::hlt
       //! * options::strategy::felsch
       //! * options::strategy::random
+      //! * options::strategy::adaptive
       //!
       //! \returns A reference to `*this`.
       //!
@@ -600,7 +784,8 @@ namespace libsemigroups {
       //!
       //! Sets the duration in nanoseconds that a given randomly selected
       //! strategy will run for, when using the random strategy
-      //! (options::strategy::random).
+      //! (options::strategy::random). This is also the length of each
+      //! interval when using options::strategy::adaptive.
       //!
       //! The default value is 200ms.
       //!
@@ -634,6 +819,72 @@ namespace libsemigroups {
         return random_interval(std::chrono::nanoseconds(val));
       }
 
+      //! Set the maximum number of threads.
+      //!
+      //! This member function sets the maximum number of threads to be used
+      //! when standardizing the coset table (see \ref standardize(order)).
+      //! A value of \c 0 is treated as \c 1. The value \p val is not limited
+      //! by the number of threads supported by the hardware.
+      //!
+      //! The default value is `std::thread::hardware_concurrency()`, or \c 1
+      //! if this is \c 0.
+      //!
+      //! \param val the maximum number of threads to use.
+      //!
+      //! \returns A reference to `*this`.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa concurrency_threshold(size_t).
+      ToddCoxeter& max_threads(size_t val) noexcept;
+
+      //! The current maximum number of threads.
+      //!
+      //! \parameters
+      //! (None)
+      //!
+      //! \returns
+      //! A value of type \c size_t.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa max_threads(size_t).
+      size_t max_threads() const noexcept;
+
+      //! Set the threshold for concurrency.
+      //!
+      //! If the number of active cosets is at least the value set by this
+      //! function, then up to \ref max_threads() threads are used when
+      //! standardizing the coset table. Otherwise only 1 thread is used.
+      //!
+      //! The default value is 1,000,000.
+      //!
+      //! \param val the new threshold.
+      //!
+      //! \returns A reference to `*this`.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa max_threads(size_t).
+      ToddCoxeter& concurrency_threshold(size_t val) noexcept;
+
+      //! The current threshold for concurrency.
+      //!
+      //! \parameters
+      //! (None)
+      //!
+      //! \returns
+      //! A value of type \c size_t.
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \sa concurrency_threshold(size_t).
+      size_t concurrency_threshold() const noexcept;
+
       //! Type of the argument to \ref sort_generating_pairs.
       //!
       //! A type alias for functions that can be used as an argument to
@@ -779,6 +1030,26 @@ namespace libsemigroups {
       //! \noexcept
       bool compatible() const noexcept;
 
+      //! Returns the number of rows of the coset table that are borrowed.
+      //!
+      //! Returns the number of rows of the coset table that are read from the
+      //! Cayley graph of parent_froidure_pin(), rather than copied, see
+      //! ToddCoxeter(congruence_kind, std::shared_ptr<FroidurePinBase>,
+      //! options::froidure_pin). A row is copied when it is first modified,
+      //! but not when the table is standardized.
+      //!
+      //! \returns A value of type \c size_t.
+      //!
+      //! \parameters
+      //! (None)
+      //!
+      //! \exceptions
+      //! \noexcept
+      //!
+      //! \complexity
+      //! Linear in the number of rows of the coset table.
+      size_t number_of_borrowed_rows() const noexcept;
+
       ////////////////////////////////////////////////////////////////////////
       // ToddCoxeter - member functions (standardization) - public
       ////////////////////////////////////////////////////////////////////////
@@ -932,7 +1203,7 @@ namespace libsemigroups {
       void init();
       void init_felsch_tree();
       void init_preimages_from_table();
-      void prefill(FroidurePinBase&);
+      void prefill(std::shared_ptr<FroidurePinBase> const&);
       void prefill_and_validate(table_type const&, bool);
       void reverse_if_necessary_and_push_back(word_type,
                                               std::vector<word_type>&);
@@ -942,11 +1213,15 @@ namespace libsemigroups {
       ////////////////////////////////////////////////////////////////////////
 
       coset_type new_coset();
+      void       rebuild_preimages();
       void       remove_preimage(coset_type, letter_type, coset_type);
 
       void make_deductions_dfs(coset_type);
       void process_deductions();
 
+      template <typename TStackDeduct>
+      void process_large_collapse();
+
       inline coset_type tau(coset_type c, letter_type a) const noexcept {
         LIBSEMIGROUPS_ASSERT(is_valid_coset(c));
         LIBSEMIGROUPS_ASSERT(a < _table.number_of_cols());
@@ -1072,7 +1347,21 @@ namespace libsemigroups {
                                  static_cast<uint64_t>(_coinc.size()));
         }
 #endif
+        if (!_track_preimages) {
+          // Without preimages, coincidences can only be processed by
+          // rescanning the entire table, and so we wait until enough have
+          // accumulated.
+          if (_coinc.size() > std::min(large_collapse(),
+                                       number_of_cosets_active() / 16)) {
+            process_large_collapse<TStackDeduct>();
+          }
+          return;
+        }
         while (!_coinc.empty()) {
+          if (_coinc.size() > large_collapse()) {
+            process_large_collapse<TStackDeduct>();
+            return;
+          }
           Coincidence c = _coinc.top();
           _coinc.pop();
           coset_type min = find_coset(c.first);
@@ -1134,6 +1423,9 @@ namespace libsemigroups {
         LIBSEMIGROUPS_ASSERT(is_valid_coset(d));
         TStackDeduct()(_deduct, c, x);
         _table.set(c, x, d);
+        if (!_track_preimages) {
+          return UNDEFINED;
+        }
         coset_type e = _preim_next.get(c, x);
         add_preimage(d, x, c);
         return e;
@@ -1146,6 +1438,7 @@ namespace libsemigroups {
       void felsch();
       void hlt();
       void sims();
+      void adaptive();
 
       void perform_lookahead();
 
@@ -1167,9 +1460,11 @@ namespace libsemigroups {
       void lex_standardize();
       void recursive_standardize();
       void shortlex_standardize();
+      void shortlex_standardize_concurrently(size_t);
 
-      void apply_permutation(std::vector<coset_type>&,
-                             std::vector<coset_type>&);
+      size_t number_of_threads() const noexcept;
+      void   apply_permutation(std::vector<coset_type>&,
+                               std::vector<coset_type>&);
       void swap(coset_type const, coset_type const);
 
       ////////////////////////////////////////////////////////////////////////
@@ -1220,7 +1515,12 @@ namespace libsemigroups {
       std::stack<Deduction>       _deduct;
       std::vector<word_type>      _extra;
       std::unique_ptr<FelschTree> _felsch_tree;
-      size_t                      _nr_pairs_added_earlier;
+      // Only used by process_large_collapse, and kept between calls so that
+      // they are not allocated every time; every entry is UNDEFINED (or a
+      // singleton in the Duf) between calls.
+      detail::Duf<>           _large_collapse_uf;
+      std::vector<coset_type> _large_collapse_min;
+      size_t                  _nr_pairs_added_earlier;
       bool                        _prefilled;
       table_type                  _preim_init;
       table_type                  _preim_next;
@@ -1228,7 +1528,8 @@ namespace libsemigroups {
       std::unique_ptr<Settings>   _settings;
       order                       _standardized;
       state                       _state;
-      table_type                  _table;
+      detail::CopyOnWriteArray2<coset_type> _table;
+      bool                                  _track_preimages;
       std::unique_ptr<Tree>       _tree;
     };
 
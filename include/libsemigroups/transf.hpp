@@ -2114,6 +2114,33 @@ namespace libsemigroups {
     }
   };
 
+  //! Specialization of the adapter GroupHClassPerm for instances of
+  //! Transf<N, Scalar> with \c N non-zero.
+  //!
+  //! \sa GroupHClassPerm.
+  template <size_t N, typename Scalar>
+  struct GroupHClassPerm<Transf<N, Scalar>, std::enable_if_t<(N > 0)>> {
+    //! The degree of the permutations.
+    static constexpr size_t degree = N;
+
+    //! The type of the permutations.
+    using type = Perm<N, Scalar>;
+
+    //! Stores the permutation induced by \p x on the image of \p e in \p
+    //! res, extended by fixing every other point.
+    //!
+    //! The points in the image of the idempotent \p e are those it fixes,
+    //! and every element of the \f$\mathscr{H}\f$-class of \p e acts
+    //! on them bijectively.
+    void operator()(type&                    res,
+                    Transf<N, Scalar> const& e,
+                    Transf<N, Scalar> const& x) const {
+      for (size_t i = 0; i < N; ++i) {
+        res[i] = (e[i] == i ? x[i] : i);
+      }
+    }
+  };
+
   ////////////////////////////////////////////////////////////////////////
   // ImageRight/LeftAction - PPerm
   ////////////////////////////////////////////////////////////////////////
@@ -2209,7 +2236,7 @@ namespace libsemigroups {
   struct ImageLeftAction<PPerm<N, Scalar>, T> {
     void operator()(T& res, T const& pt, PPerm<N, Scalar> const& x) const {
       //! Stores the inverse image set of \c pt under \c x in \p res.
-      static PPerm<N, Scalar> xx({});
+      static thread_local PPerm<N, Scalar> xx({});
       x.inverse(xx);  // invert x into xx
       ImageRightAction<PPerm<N, Scalar>, T>()(res, pt, xx);
     }
@@ -2285,7 +2312,7 @@ namespace libsemigroups {
             static_cast<uint64_t>(M),
             static_cast<uint64_t>(x.degree()));
       }
-      static PPerm<N, Scalar> xx({});
+      static thread_local PPerm<N, Scalar> xx({});
       x.inverse(xx);
       Lambda<PPerm<N, Scalar>, BitSet<M>>()(res, xx);
     }
@@ -2304,6 +2331,32 @@ namespace libsemigroups {
     }
   };
 
+  //! Specialization of the adapter GroupHClassPerm for instances of
+  //! PPerm<N, Scalar> with \c N non-zero.
+  //!
+  //! \sa GroupHClassPerm.
+  template <size_t N, typename Scalar>
+  struct GroupHClassPerm<PPerm<N, Scalar>, std::enable_if_t<(N > 0)>> {
+    //! The degree of the permutations.
+    static constexpr size_t degree = N;
+
+    //! The type of the permutations.
+    using type = Perm<N, Scalar>;
+
+    //! Stores the permutation induced by \p x on the domain of \p e in \p
+    //! res, extended by fixing every other point.
+    //!
+    //! Every element of the \f$\mathscr{H}\f$-class of the idempotent \p e
+    //! is a permutation of the domain of \p e.
+    void operator()(type&                   res,
+                    PPerm<N, Scalar> const& e,
+                    PPerm<N, Scalar> const& x) const {
+      for (size_t i = 0; i < N; ++i) {
+        res[i] = (e[i] == i ? x[i] : i);
+      }
+    }
+  };
+
   ////////////////////////////////////////////////////////////////////////
   // Perm
   ////////////////////////////////////////////////////////////////////////
@@ -447,6 +447,14 @@ namespace libsemigroups {
         std::iota(this->_data.begin() + M, this->_data.end(), M);
         this->init_data(this->_data.begin() + M, this->_data.end());
       }
+
+      // Make x a singleton again, this is only valid if every other index in
+      // the block of x is also reset.
+      void reset(size_type x) {
+        LIBSEMIGROUPS_ASSERT(x < this->size());
+        this->_data[x] = x;
+        this->init_data(this->_data.begin() + x, this->_data.begin() + x + 1);
+      }
     };
 
     // Static Union-Find
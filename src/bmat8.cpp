@@ -145,7 +145,10 @@ namespace libsemigroups {
     return w;
   }
 
-  static std::array<uint64_t, 8> for_sorting = {0, 0, 0, 0, 0, 0, 0, 0};
+  // thread_local since sort_rows, and hence row_space_basis, may be called
+  // from several threads at once, for example by Konieczny.
+  static thread_local std::array<uint64_t, 8> for_sorting
+      = {0, 0, 0, 0, 0, 0, 0, 0};
 
   static inline void swap_for_sorting(size_t a, size_t b) noexcept {
     if (for_sorting[b] < for_sorting[a]) {
@@ -23,29 +23,41 @@
 #define LIBSEMIGROUPS_SRC_KNUTH_BENDIX_IMPL_HPP_
 
 #include <algorithm>    // for max, min
+#include <array>        // for array
 #include <atomic>       // for atomic
+#include <cstdint>      // for uint64_t
 #include <cinttypes>    // for int64_t
 #include <cstddef>      // for size_t
+#include <cstdio>       // for FILE, fclose, fread, fseeko, fwrite, tmpfile
+#include <cstring>      // for memcpy
 #include <limits>       // for numeric_limits
 #include <list>         // for list, list<>::iterator
-#include <ostream>      // for string
-#include <set>          // for set
+#include <mutex>        // for mutex, lock_guard
+#include <istream>      // for istream
+#include <ostream>      // for ostream
 #include <stack>        // for stack
 #include <string>       // for operator!=, basic_strin...
+#include <thread>       // for thread
 #include <type_traits>  // for swap
 #include <utility>      // for pair
 #include <vector>       // for vector
 
+#include <sys/types.h>  // for off_t
+
 #ifdef LIBSEMIGROUPS_VERBOSE
 #include <unordered_set>  // for unordered_set
 #endif
 
-#include "libsemigroups/config.hpp"        // for LIBSEMIGROUPS_DEBUG
-#include "libsemigroups/constants.hpp"     // for POSITIVE_INFINITY
-#include "libsemigroups/debug.hpp"         // for LIBSEMIGROUPS_ASSERT
-#include "libsemigroups/knuth-bendix.hpp"  // for KnuthBendix, KnuthBendi...
-#include "libsemigroups/order.hpp"         // for shortlex_compare
-#include "libsemigroups/report.hpp"        // for REPORT
+#include "libsemigroups/config.hpp"          // for LIBSEMIGROUPS_DEBUG
+#include "libsemigroups/constants.hpp"       // for POSITIVE_INFINITY, UNDEFINED
+#include "libsemigroups/containers.hpp"      // for DynamicArray2
+#include "libsemigroups/debug.hpp"           // for LIBSEMIGROUPS_ASSERT
+#include "libsemigroups/digraph-helper.hpp"  // for is_acyclic
+#include "libsemigroups/digraph.hpp"         // for ActionDigraph
+#include "libsemigroups/exception.hpp"       // for LIBSEMIGROUPS_EXCEPTION
+#include "libsemigroups/knuth-bendix.hpp"    // for KnuthBendix, KnuthBendi...
+#include "libsemigroups/order.hpp"           // for shortlex_compare
+#include "libsemigroups/report.hpp"          // for REPORT
 #include "libsemigroups/string.hpp"  // for detail::is_suffix, maximum_comm...
 #include "libsemigroups/timer.hpp"   // for detail::Timer
 #include "libsemigroups/types.hpp"   // for word_type
@@ -70,15 +82,12 @@ namespace libsemigroups {
       // KnuthBendixImpl - nested subclasses - private
       ////////////////////////////////////////////////////////////////////////
 
-      // Rule and RuleLookup classes
+      // Rule and RuleTrie classes
       class Rule {
        public:
-        // Construct from KnuthBendix with new but empty internal_string_type's
+        // Construct from KnuthBendix with empty internal_string_type's
         explicit Rule(KnuthBendixImpl const* kbimpl, int64_t id)
-            : _kbimpl(kbimpl),
-              _lhs(new internal_string_type()),
-              _rhs(new internal_string_type()),
-              _id(-1 * id) {
+            : _kbimpl(kbimpl), _lhs(), _rhs(), _id(-1 * id) {
           LIBSEMIGROUPS_ASSERT(_id < 0);
         }
 
@@ -90,40 +99,44 @@ namespace libsemigroups {
         // accidental copying.
         Rule(Rule const& copy) = delete;
 
-        // Destructor, deletes pointers used to create the rule.
-        ~Rule() {
-          delete _lhs;
-          delete _rhs;
-        }
-
         // Returns the left hand side of the rule, which is guaranteed to be
         // greater than its right hand side according to the reduction ordering
         // of the KnuthBendix used to construct this.
-        internal_string_type* lhs() const {
-          return _lhs;
+        internal_string_type* lhs() {
+          return &_lhs;
+        }
+
+        internal_string_type const* lhs() const {
+          return &_lhs;
         }
 
         // Returns the right hand side of the rule, which is guaranteed to be
         // less than its left hand side according to the reduction ordering of
         // the KnuthBendix used to construct this.
-        internal_string_type* rhs() const {
-          return _rhs;
+        internal_string_type* rhs() {
+          return &_rhs;
+        }
+
+        internal_string_type const* rhs() const {
+          return &_rhs;
         }
 
         void rewrite() {
           LIBSEMIGROUPS_ASSERT(_id != 0);
-          _kbimpl->internal_rewrite(_lhs);
-          _kbimpl->internal_rewrite(_rhs);
+          _kbimpl->internal_rewrite(&_lhs);
+          _kbimpl->internal_rewrite(&_rhs);
           // reorder if necessary
-          if (shortlex_compare(_lhs, _rhs)) {
-            std::swap(_lhs, _rhs);
+          if (_kbimpl->less(_lhs, _rhs)) {
+            _lhs.swap(_rhs);
           }
         }
 
+        // Clears both sides, but keeps their capacity, so that the rule can be
+        // reused by new_rule without allocating.
         void clear() {
           LIBSEMIGROUPS_ASSERT(_id != 0);
-          _lhs->clear();
-          _rhs->clear();
+          _lhs.clear();
+          _rhs.clear();
         }
 
         inline bool active() const {
@@ -156,55 +169,138 @@ namespace libsemigroups {
           return _id;
         }
 
+        // The sides of a rule are stored in the rule itself rather than being
+        // allocated separately, and the short sides typical of most rules fit
+        // in the std::string itself.
         KnuthBendixImpl const* _kbimpl;
-        internal_string_type*  _lhs;
-        internal_string_type*  _rhs;
+        internal_string_type   _lhs;
+        internal_string_type   _rhs;
         int64_t                _id;
       };  // struct Rule
 
-      // Simple class wrapping a two iterators to an internal_string_type and a
-      // Rule const*
-
-      class RuleLookup {
+      // A trie of the reversed left hand sides of the active rules, which is
+      // used to find the rule (if any) whose left hand side is a suffix of a
+      // word. Since the left hand side of an active rule does not contain the
+      // left hand side of any other active rule, there is at most one such
+      // rule, and finding it requires at most one step in the trie per letter
+      // of its left hand side, independent of the number of rules.
+      class RuleTrie {
        public:
-        RuleLookup() : _rule(nullptr) {}
-
-        explicit RuleLookup(Rule* rule)
-            : _first(rule->lhs()->cbegin()),
-              _last(rule->lhs()->cend()),
-              _rule(rule) {}
-
-        RuleLookup& operator()(internal_string_type::iterator const& first,
-                               internal_string_type::iterator const& last) {
-          _first = first;
-          _last  = last;
-          return *this;
-        }
-
-        Rule const* rule() const {
-          return _rule;
-        }
-
-        // This implements reverse lex comparison of this and that, which
-        // satisfies the requirement of std::set that equivalent items be
-        // incomparable, so, for example bcbc and abcbc are considered
-        // equivalent, but abcba and bcbc are not.
-        bool operator<(RuleLookup const& that) const {
-          auto it_this = _last - 1;
-          auto it_that = that._last - 1;
-          while (it_this > _first && it_that > that._first
-                 && *it_this == *it_that) {
-            --it_that;
-            --it_this;
+        using index_type = size_t;
+
+        RuleTrie()
+            : _children(0, 1, UNDEFINED),
+              _free(),
+              _letter({UNDEFINED}),
+              _number_of_children({0}),
+              _number_of_rules(0),
+              _parent({UNDEFINED}),
+              _rule({nullptr}) {}
+
+        RuleTrie& operator=(RuleTrie const&) = delete;
+        RuleTrie(RuleTrie const&)            = delete;
+
+        void add(Rule const* rule) {
+          index_type node = 0;
+          for (auto it = rule->lhs()->crbegin(); it != rule->lhs()->crend();
+               ++it) {
+            size_t const a = internal_char_to_uint(*it);
+            if (a >= _children.number_of_cols()) {
+              _children = decltype(_children)(
+                  _children, a + 1 - _children.number_of_cols());
+            }
+            index_type next = _children.get(node, a);
+            if (next == UNDEFINED) {
+              next = new_node(node, a);
+              _children.set(node, a, next);
+              _number_of_children[node]++;
+            }
+            node = next;
           }
-          return *it_this < *it_that;
+          LIBSEMIGROUPS_ASSERT(_rule[node] == nullptr);
+          _rule[node] = rule;
+          _number_of_rules++;
+        }
+
+        void remove(Rule const* rule) {
+          index_type node = 0;
+          for (auto it = rule->lhs()->crbegin(); it != rule->lhs()->crend();
+               ++it) {
+            node = _children.get(node, internal_char_to_uint(*it));
+            LIBSEMIGROUPS_ASSERT(node != UNDEFINED);
+          }
+          LIBSEMIGROUPS_ASSERT(_rule[node] == rule);
+          _rule[node] = nullptr;
+          _number_of_rules--;
+          // Remove the nodes that no longer lead to any rule
+          while (node != 0 && _rule[node] == nullptr
+                 && _number_of_children[node] == 0) {
+            index_type const parent = _parent[node];
+            _children.set(parent, _letter[node], UNDEFINED);
+            _number_of_children[parent]--;
+            _free.push_back(node);
+            node = parent;
+          }
+        }
+
+        // Returns the rule whose left hand side is a suffix of [first, last),
+        // or nullptr if there is no such rule.
+        Rule const*
+        find_suffix(internal_string_type::const_iterator const& first,
+                    internal_string_type::const_iterator const& last) const {
+          index_type node = 0;
+          for (auto it = last; it > first;) {
+            --it;
+            size_t const a = internal_char_to_uint(*it);
+            if (a >= _children.number_of_cols()) {
+              return nullptr;
+            }
+            node = _children.get(node, a);
+            if (node == UNDEFINED) {
+              return nullptr;
+            } else if (_rule[node] != nullptr) {
+              return _rule[node];
+            }
+          }
+          return nullptr;
+        }
+
+        size_t number_of_rules() const noexcept {
+          return _number_of_rules;
         }
 
        private:
-        internal_string_type::const_iterator _first;
-        internal_string_type::const_iterator _last;
-        Rule const*                          _rule;
-      };  // class RuleLookup
+        index_type new_node(index_type parent, size_t a) {
+          index_type node;
+          if (_free.empty()) {
+            node = _parent.size();
+            _children.add_rows(1);
+            _letter.push_back(a);
+            _number_of_children.push_back(0);
+            _parent.push_back(parent);
+            _rule.push_back(nullptr);
+          } else {
+            node = _free.back();
+            _free.pop_back();
+            for (size_t b = 0; b < _children.number_of_cols(); ++b) {
+              _children.set(node, b, UNDEFINED);
+            }
+            _letter[node]             = a;
+            _number_of_children[node] = 0;
+            _parent[node]             = parent;
+            LIBSEMIGROUPS_ASSERT(_rule[node] == nullptr);
+          }
+          return node;
+        }
+
+        detail::DynamicArray2<index_type> _children;
+        std::vector<index_type>           _free;
+        std::vector<size_t>               _letter;
+        std::vector<size_t>               _number_of_children;
+        size_t                            _number_of_rules;
+        std::vector<index_type>           _parent;
+        std::vector<Rule const*>          _rule;
+      };  // class RuleTrie
 
       // Overlap measures
       struct OverlapMeasure {
@@ -256,6 +352,135 @@ namespace libsemigroups {
         }
       };
 
+      // A first-in first-out queue of the pairs of words defining the rules
+      // whose processing has been deferred. The words are stored one after
+      // another, each preceded by its length, in a single buffer in memory or
+      // in a temporary file (which is removed when the queue is emptied),
+      // rather than in Rule objects.
+      class DeferredQueue {
+       public:
+        DeferredQueue()
+            : _file(nullptr), _memory(), _read(0), _size(0), _write(0) {}
+
+        DeferredQueue(DeferredQueue const&) = delete;
+        DeferredQueue& operator=(DeferredQueue const&) = delete;
+
+        ~DeferredQueue() {
+          clear();
+        }
+
+        bool empty() const noexcept {
+          return _size == 0;
+        }
+
+        size_t size() const noexcept {
+          return _size;
+        }
+
+        // Where the pairs are stored is only decided when the queue is empty.
+        void push(internal_string_type const& u,
+                  internal_string_type const& v,
+                  bool                        on_disk) {
+          if (empty() && on_disk) {
+            _file = std::tmpfile();
+            if (_file == nullptr) {
+              LIBSEMIGROUPS_EXCEPTION("cannot create a temporary file for the "
+                                      "deferred rules");
+            }
+          }
+          put(u);
+          put(v);
+          ++_size;
+        }
+
+        void pop(internal_string_type& u, internal_string_type& v) {
+          LIBSEMIGROUPS_ASSERT(!empty());
+          _read = get(_read, u);
+          _read = get(_read, v);
+          if (--_size == 0) {
+            clear();
+          } else if (_file == nullptr && 2 * _read > _write) {
+            _memory.erase(0, _read);
+            _write -= _read;
+            _read = 0;
+          }
+        }
+
+        template <typename T>
+        void for_each(T&& func) const {
+          internal_string_type u, v;
+          size_t               pos = _read;
+          for (size_t i = 0; i < _size; ++i) {
+            pos = get(pos, u);
+            pos = get(pos, v);
+            func(u, v);
+          }
+        }
+
+        void clear() {
+          if (_file != nullptr) {
+            std::fclose(_file);
+            _file = nullptr;
+          }
+          internal_string_type().swap(_memory);
+          _read  = 0;
+          _size  = 0;
+          _write = 0;
+        }
+
+       private:
+        void put(internal_string_type const& w) {
+          uint64_t const n = w.size();
+          if (_file == nullptr) {
+            _memory.append(reinterpret_cast<char const*>(&n), sizeof(n));
+            _memory.append(w);
+          } else if (!seek(_write) || std::fwrite(&n, sizeof(n), 1, _file) != 1
+                     || (n > 0 && std::fwrite(w.data(), n, 1, _file) != 1)) {
+            LIBSEMIGROUPS_EXCEPTION("cannot write the deferred rules to a "
+                                    "temporary file");
+          }
+          _write += sizeof(n) + n;
+        }
+
+        // Moves to position pos in the temporary file. This uses fseeko,
+        // since the offset taken by std::fseek is a long, which may be too
+        // small for the size of the file.
+        bool seek(size_t pos) const {
+          if (pos > static_cast<uint64_t>(std::numeric_limits<off_t>::max())) {
+            LIBSEMIGROUPS_EXCEPTION("the deferred rules are too large for a "
+                                    "temporary file");
+          }
+          return fseeko(_file, static_cast<off_t>(pos), SEEK_SET) == 0;
+        }
+
+        // Reads the word at position pos into w, and returns the position of
+        // the next word.
+        size_t get(size_t pos, internal_string_type& w) const {
+          uint64_t n;
+          if (_file == nullptr) {
+            std::memcpy(&n, _memory.data() + pos, sizeof(n));
+            w.assign(_memory, pos + sizeof(n), n);
+          } else {
+            if (!seek(pos) || std::fread(&n, sizeof(n), 1, _file) != 1) {
+              LIBSEMIGROUPS_EXCEPTION("cannot read the deferred rules from a "
+                                      "temporary file");
+            }
+            w.resize(n);
+            if (n > 0 && std::fread(&w[0], n, 1, _file) != 1) {
+              LIBSEMIGROUPS_EXCEPTION("cannot read the deferred rules from a "
+                                      "temporary file");
+            }
+          }
+          return pos + sizeof(n) + n;
+        }
+
+        std::FILE*           _file;
+        internal_string_type _memory;
+        size_t               _read;
+        size_t               _size;
+        size_t               _write;
+      };  // class DeferredQueue
+
       //////////////////////////////////////////////////////////////////////////
       // KnuthBendixImpl - friend declarations - private
       //////////////////////////////////////////////////////////////////////////
@@ -272,18 +497,27 @@ namespace libsemigroups {
           : _active_rules(),
             _confluent(false),
             _confluence_known(false),
+            _confluence_checked_cols(0),
+            _confluence_checked_rows(0),
+            _confluence_mtx(),
             _inactive_rules(),
             _internal_is_same_as_external(false),
             _contains_empty_string(false),
+            _deferred(),
             _kb(kb),
             _min_length_lhs_rule(std::numeric_limits<size_t>::max()),
+            _number_of_active_rules(0),
+            _number_of_discarded_rules(0),
+            _number_of_overlaps(0),
             _overlap_measure(nullptr),
+            _overlaps_max_overlap(POSITIVE_INFINITY),
+            _rule_trie(),
             _stack(),
             _tmp_word1(new internal_string_type()),
             _tmp_word2(new internal_string_type()),
             _total_rules(0) {
-        _next_rule_it1 = _active_rules.end();  // null
-        _next_rule_it2 = _active_rules.end();  // null
+        _next_rule_pos1 = 0;  // null
+        _next_rule_pos2 = 0;  // null
         this->set_overlap_policy(options::overlap::ABC);
 #ifdef LIBSEMIGROUPS_VERBOSE
         _max_stack_depth        = 0;
@@ -298,7 +532,7 @@ namespace libsemigroups {
         delete _tmp_word1;
         delete _tmp_word2;
         for (Rule const* rule : _active_rules) {
-          delete const_cast<Rule*>(rule);
+          delete rule;
         }
         for (Rule* rule : _inactive_rules) {
           delete rule;
@@ -404,24 +638,75 @@ namespace libsemigroups {
 
       void add_rule(std::string const& p, std::string const& q) {
         LIBSEMIGROUPS_ASSERT(p != q);
-        auto pp = new external_string_type(p);
-        auto qq = new external_string_type(q);
-        external_to_internal_string(*pp);
-        external_to_internal_string(*qq);
-        push_stack(new_rule(pp, qq));
+        Rule* rule = new_rule(p.cbegin(), p.cend(), q.cbegin(), q.cend());
+        external_to_internal_string(rule->_lhs);
+        external_to_internal_string(rule->_rhs);
+        if (less(rule->_lhs, rule->_rhs)) {
+          rule->_lhs.swap(rule->_rhs);
+        }
+        push_stack(rule);
       }
 
       void add_rules(KnuthBendixImpl const* impl) {
         for (Rule const* rule : impl->_active_rules) {
-          add_rule(new_rule(rule));
+          if (rule != nullptr) {
+            add_rule(new_rule(rule));
+          }
+        }
+      }
+
+      // Adds the deferred rules of impl, whose alphabet must be the same as
+      // that of this, to the deferred rules of this.
+      void add_deferred_rules(KnuthBendixImpl const* impl) {
+        impl->_deferred.for_each(
+            [this](internal_string_type const& u,
+                   internal_string_type const& v) { defer(u, v); });
+      }
+
+      // Reorients and reduces the active rules after the reduction ordering
+      // has changed, this must be called before running.
+      void reorder_rules() {
+        LIBSEMIGROUPS_ASSERT(_stack.empty());
+        for (size_t i = 0; i < _active_rules.size(); ++i) {
+          Rule* rule = const_cast<Rule*>(_active_rules[i]);
+          if (rule != nullptr) {
+            remove_rule(i);
+            if (less(*rule->lhs(), *rule->rhs())) {
+              rule->_lhs.swap(rule->_rhs);
+            }
+            _stack.emplace(rule);
+          }
         }
+        _min_length_lhs_rule = std::numeric_limits<size_t>::max();
+        clear_stack();
+      }
+
+      // Deletes the inactive rules, kept for reuse by new_rule, that exceed the
+      // maximum number allowed by the settings.
+      void prune_inactive_rules() {
+        while (_inactive_rules.size() > _kb->_settings._max_inactive_rules) {
+          delete _inactive_rules.back();
+          _inactive_rules.pop_back();
+          ++_number_of_discarded_rules;
+        }
+      }
+
+      size_t number_of_deferred_rules() const noexcept {
+        return _deferred.size();
+      }
+
+      size_t number_of_overlaps() const noexcept {
+        return _number_of_overlaps;
       }
 
       std::vector<std::pair<std::string, std::string>> rules() const {
         std::vector<std::pair<external_string_type, external_string_type>>
             rules;
-        rules.reserve(_active_rules.size());
+        rules.reserve(_number_of_active_rules);
         for (Rule const* rule : _active_rules) {
+          if (rule == nullptr) {
+            continue;
+          }
           internal_string_type lhs = internal_string_type(*rule->lhs());
           internal_string_type rhs = internal_string_type(*rule->rhs());
           internal_to_external_string(lhs);
@@ -441,7 +726,223 @@ namespace libsemigroups {
       }
 
       size_t number_of_rules() const {
-        return _active_rules.size();
+        return _number_of_active_rules;
+      }
+
+      // Initialises <ad> to be the Gilman digraph of the active rules, using
+      // a trie of the left hand sides of the active rules, completed into an
+      // automaton using failure links (Aho-Corasick). The nodes of <ad> are
+      // the nodes of the trie that are not the left hand side of a rule, and
+      // 0 is the root. Linear in the total length of the left hand sides
+      // times the size of the alphabet. The rules are assumed to be reduced,
+      // i.e. no left hand side is a subword of another.
+      void gilman_digraph(ActionDigraph<size_t>& ad) const {
+        size_t const n = _kb->alphabet().size();
+        // Build the trie, a node is terminal if it is a left hand side
+        detail::DynamicArray2<size_t> children(n, 1, UNDEFINED);
+        std::vector<bool>     terminal(1, false);
+        for (Rule const* rule : _active_rules) {
+          if (rule == nullptr) {
+            continue;
+          }
+          size_t node = 0;
+          for (auto it = rule->lhs()->cbegin(); it < rule->lhs()->cend();
+               ++it) {
+            size_t const a    = internal_char_to_uint(*it);
+            size_t       next = children.get(node, a);
+            if (next == UNDEFINED) {
+              next = children.number_of_rows();
+              children.add_rows(1);
+              terminal.push_back(false);
+              children.set(node, a, next);
+            }
+            node = next;
+          }
+          LIBSEMIGROUPS_ASSERT(!terminal[node]);
+          terminal[node] = true;
+        }
+        // Compute the failure links in breadth first order, and replace every
+        // missing child by the target of the corresponding failure
+        // transition.
+        std::vector<size_t> failure(children.number_of_rows(), 0);
+        std::vector<size_t> queue;
+        queue.reserve(children.number_of_rows());
+        for (size_t a = 0; a < n; ++a) {
+          size_t const child = children.get(0, a);
+          if (child == UNDEFINED) {
+            children.set(0, a, 0);
+          } else {
+            queue.push_back(child);
+          }
+        }
+        for (size_t i = 0; i < queue.size(); ++i) {
+          size_t const node = queue[i];
+          LIBSEMIGROUPS_ASSERT(!terminal[failure[node]]);
+          for (size_t a = 0; a < n; ++a) {
+            size_t const child = children.get(node, a);
+            size_t const fail  = children.get(failure[node], a);
+            if (child == UNDEFINED) {
+              children.set(node, a, fail);
+            } else {
+              failure[child] = fail;
+              queue.push_back(child);
+            }
+          }
+        }
+        // Number the non-terminal nodes, and add the edges between them
+        std::vector<size_t> id(children.number_of_rows(), 0);
+        size_t              number_of_nodes = 0;
+        for (size_t node = 0; node < children.number_of_rows(); ++node) {
+          if (!terminal[node]) {
+            id[node] = number_of_nodes++;
+          }
+        }
+        ad.add_nodes(number_of_nodes);
+        ad.add_to_out_degree(n);
+        for (size_t node = 0; node < children.number_of_rows(); ++node) {
+          if (!terminal[node]) {
+            for (size_t a = 0; a < n; ++a) {
+              size_t const target = children.get(node, a);
+              if (!terminal[target]) {
+                ad.add_edge(id[node], id[target], a);
+              }
+            }
+          }
+        }
+      }
+
+      // Sets <table> to be the right Cayley graph of the semigroup defined by
+      // the active rules, which must be confluent, where <ad> is the Gilman
+      // digraph, which must be acyclic. Row 0 corresponds to the empty word,
+      // and the other rows to the non-empty normal forms in short-lex order.
+      // The columns correspond to the letters that are normal forms, in
+      // order, and so the row of the letter in column c is c + 1. If every
+      // letter has a normal form of length 1, then gens[a] is set to the row
+      // of the normal form of the letter a, and true is returned. Otherwise
+      // false is returned and <table> is not modified.
+      bool right_cayley_graph(ActionDigraph<size_t> const& ad,
+                              detail::DynamicArray2<size_t>& table,
+                              std::vector<size_t>&           gens) const {
+        LIBSEMIGROUPS_ASSERT(action_digraph_helper::is_acyclic(ad));
+        size_t const        n = _kb->alphabet().size();
+        std::vector<size_t> column(n, static_cast<size_t>(UNDEFINED));
+        std::vector<size_t> letter;
+        for (size_t a = 0; a < n; ++a) {
+          if (ad.unsafe_neighbor(0, a) != UNDEFINED) {
+            column[a] = letter.size();
+            letter.push_back(a);
+          }
+        }
+        gens.assign(n, static_cast<size_t>(UNDEFINED));
+        internal_string_type w;
+        for (size_t a = 0; a < n; ++a) {
+          if (column[a] == UNDEFINED) {
+            w.assign(1, uint_to_internal_char(a));
+            internal_rewrite(&w);
+            if (w.size() != 1) {
+              return false;
+            }
+            gens[a] = column[internal_char_to_uint(w[0])] + 1;
+          } else {
+            gens[a] = column[a] + 1;
+          }
+        }
+
+        // The prefixes of a normal form are normal forms, and so the normal
+        // forms are the nodes of a tree (the paths in ad starting at 0), which
+        // we number in short-lex order. If the ordering is short-lex, then
+        // most edges not in the tree can be found using the edges already
+        // found, exactly as in the Froidure-Pin algorithm, where a word is
+        // reduced if it is a normal form. Otherwise, or if this is not
+        // possible, the edge is found by rewriting.
+        size_t const                  k = letter.size();
+        detail::DynamicArray2<size_t> right(
+            k, k + 1, static_cast<size_t>(UNDEFINED));
+        detail::DynamicArray2<size_t> left(k, k + 1);
+        std::vector<size_t>           node(k + 1, 0);
+        std::vector<size_t>           prefix(k + 1, 0);
+        std::vector<size_t>           suffix(k + 1, 0);
+        std::vector<size_t>           first(k + 1, 0);
+        std::vector<size_t>           final(k + 1, 0);
+        for (size_t c = 0; c < k; ++c) {
+          right.set(0, c, c + 1);
+          left.set(0, c, c + 1);
+          node[c + 1]  = ad.unsafe_neighbor(0, letter[c]);
+          first[c + 1] = c;
+          final[c + 1] = c;
+        }
+        bool const shortlex = _kb->_settings._order == options::order::shortlex;
+
+        // Sets right(i, c) by rewriting, the normal form of the product must
+        // already belong to the tree.
+        auto rewrite = [&](size_t i, size_t c) {
+          w.clear();
+          for (size_t j = i; j != 0; j = prefix[j]) {
+            w.push_back(uint_to_internal_char(letter[final[j]]));
+          }
+          std::reverse(w.begin(), w.end());
+          w.push_back(uint_to_internal_char(letter[c]));
+          internal_rewrite(&w, w.size() - 1);
+          size_t j = 0;
+          for (auto const& a : w) {
+            j = right.get(j, column[internal_char_to_uint(a)]);
+          }
+          right.set(i, c, j);
+        };
+
+        for (size_t lo = 1, hi = k + 1; lo < hi; lo = hi, hi = node.size()) {
+          // Multiply the normal forms in [lo, hi) by every letter
+          for (size_t i = lo; i < hi; ++i) {
+            size_t const b = first[i];
+            size_t const s = suffix[i];
+            for (size_t c = 0; c < k; ++c) {
+              size_t const m = ad.unsafe_neighbor(node[i], letter[c]);
+              if (m != UNDEFINED) {
+                // w = bs and wc is a normal form
+                right.set(i, c, node.size());
+                right.add_rows(1);
+                left.add_rows(1);
+                node.push_back(m);
+                prefix.push_back(i);
+                suffix.push_back(right.get(s, c));
+                first.push_back(b);
+                final.push_back(c);
+              } else if (!shortlex) {
+                // The normal form of wc might be longer than wc, and so might
+                // not belong to the tree yet.
+                continue;
+              } else if (ad.unsafe_neighbor(node[s], letter[c]) == UNDEFINED) {
+                // sc is not a normal form, and so wc = b * nf(sc)
+                size_t const r = right.get(s, c);
+                right.set(i,
+                          c,
+                          r == 0 ? b + 1
+                                 : right.get(left.get(prefix[r], b), final[r]));
+              } else {
+                rewrite(i, c);
+              }
+            }
+          }
+          if (shortlex) {
+            // Left multiply the normal forms in [lo, hi) by every letter
+            for (size_t i = lo; i < hi; ++i) {
+              for (size_t c = 0; c < k; ++c) {
+                left.set(i, c, right.get(left.get(prefix[i], c), final[i]));
+              }
+            }
+          }
+        }
+        if (!shortlex) {
+          for (size_t i = 1; i < node.size(); ++i) {
+            for (size_t c = 0; c < k; ++c) {
+              if (right.get(i, c) == UNDEFINED) {
+                rewrite(i, c);
+              }
+            }
+          }
+        }
+        table = std::move(right);
+        return true;
       }
 
      private:
@@ -464,25 +965,10 @@ namespace libsemigroups {
         return rule;
       }
 
-      Rule* new_rule(internal_string_type* lhs,
-                     internal_string_type* rhs) const {
-        Rule* rule = new_rule();
-        delete rule->_lhs;
-        delete rule->_rhs;
-        if (shortlex_compare(rhs, lhs)) {
-          rule->_lhs = lhs;
-          rule->_rhs = rhs;
-        } else {
-          rule->_lhs = rhs;
-          rule->_rhs = lhs;
-        }
-        return rule;
-      }
-
       Rule* new_rule(Rule const* rule1) const {
         Rule* rule2 = new_rule();
-        rule2->_lhs->append(*rule1->lhs());  // copies lhs
-        rule2->_rhs->append(*rule1->rhs());  // copies rhs
+        rule2->_lhs.append(*rule1->lhs());  // copies lhs
+        rule2->_rhs.append(*rule1->rhs());  // copies rhs
         return rule2;
       }
 
@@ -491,69 +977,258 @@ namespace libsemigroups {
                      internal_string_type::const_iterator begin_rhs,
                      internal_string_type::const_iterator end_rhs) const {
         Rule* rule = new_rule();
-        rule->_lhs->append(begin_lhs, end_lhs);
-        rule->_rhs->append(begin_rhs, end_rhs);
+        rule->_lhs.append(begin_lhs, end_lhs);
+        rule->_rhs.append(begin_rhs, end_rhs);
         return rule;
       }
 
+      // Returns rule to the pool of inactive rules, or deletes it if the pool
+      // is already as large as allowed by the settings.
+      void release_rule(Rule* rule) {
+        LIBSEMIGROUPS_ASSERT(!rule->active());
+        if (_inactive_rules.size() < _kb->_settings._max_inactive_rules) {
+          _inactive_rules.push_back(rule);
+        } else {
+          delete rule;
+          ++_number_of_discarded_rules;
+        }
+      }
+
+      void defer(internal_string_type const& u, internal_string_type const& v) {
+        _deferred.push(u, v, _kb->_settings._defer_to_disk);
+      }
+
+      // Rewrites rule and, if its sides are still different, adds it to the
+      // queue of deferred rules, rule itself is released in either case.
+      void defer_rule(Rule* rule) {
+        rule->rewrite();
+        if (*rule->lhs() != *rule->rhs()) {
+          defer(rule->_lhs, rule->_rhs);
+        }
+        release_rule(rule);
+      }
+
       void add_rule(Rule* rule) {
         LIBSEMIGROUPS_ASSERT(*rule->lhs() != *rule->rhs());
 #ifdef LIBSEMIGROUPS_VERBOSE
         _max_word_length  = std::max(_max_word_length, rule->lhs()->size());
-        _max_active_rules = std::max(_max_active_rules, _active_rules.size());
+        _max_active_rules = std::max(_max_active_rules, _number_of_active_rules);
         _unique_lhs_rules.insert(*rule->lhs());
 #endif
-        LIBSEMIGROUPS_ASSERT(_set_rules.emplace(RuleLookup(rule)).second);
-#ifndef LIBSEMIGROUPS_DEBUG
-        _set_rules.emplace(RuleLookup(rule));
-#endif
+        _rule_trie.add(rule);
         rule->activate();
-        _active_rules.push_back(rule);
-        if (_next_rule_it1 == _active_rules.end()) {
-          --_next_rule_it1;
-        }
-        if (_next_rule_it2 == _active_rules.end()) {
-          --_next_rule_it2;
+        if (_active_rules.size() - _number_of_active_rules
+            > std::max(_number_of_active_rules, size_t(64))) {
+          compact_active_rules();
         }
+        // If _next_rule_pos1 or _next_rule_pos2 is the end of _active_rules,
+        // then after this they point to rule.
+        _active_rules.push_back(rule);
+        _number_of_active_rules++;
         _confluence_known = false;
         if (rule->lhs()->size() < _min_length_lhs_rule) {
-          // TODO(later) this is not valid when using non-length reducing
-          // orderings (such as RECURSIVE)
           _min_length_lhs_rule = rule->lhs()->size();
         }
         if (!_contains_empty_string) {
           _contains_empty_string = rule->lhs()->empty() || rule->rhs()->empty();
         }
-        LIBSEMIGROUPS_ASSERT(_set_rules.size() == _active_rules.size());
+        LIBSEMIGROUPS_ASSERT(_rule_trie.number_of_rules()
+                             == _number_of_active_rules);
       }
 
-      std::list<Rule const*>::iterator
-      remove_rule(std::list<Rule const*>::iterator it) {
+      // Removing a rule leaves a tombstone (nullptr) in _active_rules, so
+      // that the positions of the other rules do not change. If
+      // _next_rule_pos1 is the position of the rule, then it is moved to the
+      // next active rule.
+      void remove_rule(size_t pos) {
 #ifdef LIBSEMIGROUPS_VERBOSE
-        _unique_lhs_rules.erase(*((*it)->lhs()));
+        _unique_lhs_rules.erase(*_active_rules[pos]->lhs());
 #endif
-        Rule* rule = const_cast<Rule*>(*it);
+        Rule* rule = const_cast<Rule*>(_active_rules[pos]);
         rule->deactivate();
-        if (it != _next_rule_it1 && it != _next_rule_it2) {
-          it = _active_rules.erase(it);
-        } else if (it == _next_rule_it1 && it != _next_rule_it2) {
-          _next_rule_it1 = _active_rules.erase(it);
-          it             = _next_rule_it1;
-        } else if (it != _next_rule_it1 && it == _next_rule_it2) {
-          _next_rule_it2 = _active_rules.erase(it);
-          it             = _next_rule_it2;
-        } else {
-          _next_rule_it1 = _active_rules.erase(it);
-          _next_rule_it2 = _next_rule_it1;
-          it             = _next_rule_it1;
+        _active_rules[pos] = nullptr;
+        _number_of_active_rules--;
+        // The critical pairs already checked in confluent() might only have
+        // been resolved using this rule.
+        _confluence_checked_rows = 0;
+        _confluence_checked_cols = 0;
+        if (pos == _next_rule_pos1) {
+          _next_rule_pos1 = next_active_rule(pos + 1);
         }
-#ifdef LIBSEMIGROUPS_DEBUG
-        LIBSEMIGROUPS_ASSERT(_set_rules.erase(RuleLookup(rule)));
-#else
-        _set_rules.erase(RuleLookup(rule));
-#endif
-        LIBSEMIGROUPS_ASSERT(_set_rules.size() == _active_rules.size());
-        return it;
+        _rule_trie.remove(rule);
+        LIBSEMIGROUPS_ASSERT(_rule_trie.number_of_rules()
+                             == _number_of_active_rules);
+      }
+
+      // Returns the position of the first active rule not before pos, or the
+      // size of _active_rules if there is no such rule.
+      size_t next_active_rule(size_t pos) const {
+        while (pos < _active_rules.size() && _active_rules[pos] == nullptr) {
+          ++pos;
+        }
+        return pos;
+      }
+
+      // Returns the position of the last active rule before pos, or UNDEFINED
+      // if there is no such rule.
+      size_t prev_active_rule(size_t pos) const {
+        while (pos > 0) {
+          --pos;
+          if (_active_rules[pos] != nullptr) {
+            return pos;
+          }
+        }
+        return UNDEFINED;
+      }
+
+      // Batches with fewer than this many words per thread are not split
+      // between threads.
+      static constexpr size_t BATCH_WORDS_PER_THREAD = 256;
+
+      size_t number_of_batch_threads(std::vector<size_t> const& ends) const {
+        return std::max(
+            size_t(1),
+            std::min(_kb->_settings._max_threads,
+                     ends.size() / BATCH_WORDS_PER_THREAD));
+      }
+
+      // Rewrites every word in words (in the format described in
+      // normal_forms), and calls func(t, i, w) where t is the index of the
+      // thread, i is the index of the word, and w is its normal form. The
+      // words are split into number_of_batch_threads(ends) contiguous ranges,
+      // whose lengths are multiples of group_size, and the t-th thread
+      // processes the t-th range in order. This only reads the rules, and so
+      // the rules must not be modified while it is running.
+      template <typename TFunction>
+      void rewrite_words(external_string_type const& words,
+                         std::vector<size_t> const&  ends,
+                         size_t                      group_size,
+                         TFunction&&                 func) const {
+        LIBSEMIGROUPS_ASSERT(ends.size() % group_size == 0);
+        // Converting via _kb->char_to_uint for every letter is too slow.
+        std::array<internal_char_type, 256> to_internal;
+        std::array<external_char_type, 256> to_external;
+        if (!_internal_is_same_as_external) {
+          std::string const& lphbt = _kb->alphabet();
+          for (size_t i = 0; i < lphbt.size(); ++i) {
+            internal_char_type const c = uint_to_internal_char(i);
+            to_internal[static_cast<unsigned char>(lphbt[i])] = c;
+            to_external[static_cast<unsigned char>(c)]        = lphbt[i];
+          }
+        }
+
+        size_t const T = number_of_batch_threads(ends);
+        size_t const number_of_groups = ends.size() / group_size;
+        auto         rewrite = [&](size_t t) {
+          size_t const first = (number_of_groups * t / T) * group_size;
+          size_t const last  = (number_of_groups * (t + 1) / T) * group_size;
+          internal_string_type w;  // reused for every word
+          for (size_t i = first; i < last; ++i) {
+            w.assign(words,
+                     (i == 0 ? 0 : ends[i - 1]),
+                     ends[i] - (i == 0 ? 0 : ends[i - 1]));
+            if (!_internal_is_same_as_external) {
+              for (auto& a : w) {
+                a = to_internal[static_cast<unsigned char>(a)];
+              }
+              internal_rewrite(&w);
+              for (auto& a : w) {
+                a = to_external[static_cast<unsigned char>(a)];
+              }
+            } else {
+              internal_rewrite(&w);
+            }
+            func(t, i, w);
+          }
+        };
+
+        if (T == 1) {
+          rewrite(0);
+          return;
+        }
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < T; ++t) {
+          threads.emplace_back(rewrite, t);
+        }
+        for (auto& thread : threads) {
+          thread.join();
+        }
+      }
+
+      // Returns the position that pos would have if _active_rules contained
+      // no tombstones.
+      size_t compacted_position(size_t pos) const {
+        pos = std::min(pos, _active_rules.size());
+        return pos
+               - std::count(_active_rules.cbegin(),
+                            _active_rules.cbegin() + pos,
+                            nullptr);
+      }
+
+      void write_word(std::ostream& os, internal_string_type v) const {
+        for (auto& c : v) {
+          c = static_cast<internal_char_type>(internal_char_to_uint(c));
+        }
+        write_string(os, v);
+      }
+
+      internal_string_type read_word(std::istream& is, size_t n) const {
+        internal_string_type v = read_string(is);
+        for (auto& c : v) {
+          size_t const a = static_cast<unsigned char>(c);
+          if (a >= n) {
+            LIBSEMIGROUPS_EXCEPTION("invalid input, expected letters in the "
+                                    "range [0, %llu), found %llu",
+                                    uint64_t(n),
+                                    uint64_t(a));
+          }
+          c = uint_to_internal_char(a);
+        }
+        return v;
+      }
+
+      void write_rule(std::ostream& os, Rule const* rule) const {
+        write_word(os, *rule->lhs());
+        write_word(os, *rule->rhs());
+      }
+
+      Rule* read_rule(std::istream& is, size_t n) const {
+        internal_string_type const u = read_word(is, n);
+        internal_string_type const v = read_word(is, n);
+        if (u == v) {
+          LIBSEMIGROUPS_EXCEPTION(
+              "invalid input, the sides of a rule must be different");
+        }
+        return new_rule(u.cbegin(), u.cend(), v.cbegin(), v.cend());
+      }
+
+      // Removes the tombstones from _active_rules, and modifies
+      // _next_rule_pos1, _next_rule_pos2, and the positions used by
+      // confluent(), so that they still point at the same rule, or at the
+      // next rule if they point at a tombstone.
+      void compact_active_rules() {
+        std::array<size_t*, 4> pos = {&_next_rule_pos1,
+                                      &_next_rule_pos2,
+                                      &_confluence_checked_rows,
+                                      &_confluence_checked_cols};
+        std::array<size_t, 4>  new_pos;
+        new_pos.fill(UNDEFINED);
+        size_t j = 0;
+        for (size_t i = 0; i < _active_rules.size(); ++i) {
+          for (size_t k = 0; k < pos.size(); ++k) {
+            if (i == *pos[k]) {
+              new_pos[k] = j;
+            }
+          }
+          if (_active_rules[i] != nullptr) {
+            _active_rules[j++] = _active_rules[i];
+          }
+        }
+        LIBSEMIGROUPS_ASSERT(j == _number_of_active_rules);
+        for (size_t k = 0; k < pos.size(); ++k) {
+          *pos[k] = (*pos[k] >= _active_rules.size() ? j : new_pos[k]);
+        }
+        _active_rules.resize(j);
       }
 
      public:
@@ -590,6 +1265,67 @@ namespace libsemigroups {
         return uu == vv;
       }
 
+      // The i-th word in words is [ends[i - 1], ends[i]) where ends[-1] = 0.
+      // The normal forms of the words are written to result in the same
+      // format. The words must be valid.
+      void normal_forms(external_string_type const& words,
+                        std::vector<size_t> const&  ends,
+                        external_string_type&       result,
+                        std::vector<size_t>&        result_ends) const {
+        size_t const                      T = number_of_batch_threads(ends);
+        std::vector<external_string_type> out(T);
+        std::vector<std::vector<size_t>>  out_ends(T);
+        rewrite_words(words,
+                      ends,
+                      1,
+                      [&out, &out_ends](size_t                      t,
+                                        size_t                      i,
+                                        external_string_type const& w) {
+                        (void) i;
+                        out[t].append(w);
+                        out_ends[t].push_back(out[t].size());
+                      });
+        result.clear();
+        result_ends.clear();
+        result_ends.reserve(ends.size());
+        for (size_t t = 0; t < T; ++t) {
+          size_t const offset = result.size();
+          result.append(out[t]);
+          for (size_t const end : out_ends[t]) {
+            result_ends.push_back(offset + end);
+          }
+        }
+      }
+
+      // The words in words are as in normal_forms, and result[i] is true if
+      // and only if the words with indices 2i and 2i + 1 have equal normal
+      // forms.
+      void equal_to(external_string_type const& words,
+                    std::vector<size_t> const&  ends,
+                    std::vector<bool>&          result) const {
+        LIBSEMIGROUPS_ASSERT(ends.size() % 2 == 0);
+        size_t const                      T = number_of_batch_threads(ends);
+        std::vector<external_string_type> prev(T);
+        std::vector<std::vector<bool>>    out(T);
+        rewrite_words(words,
+                      ends,
+                      2,
+                      [&prev, &out](size_t                      t,
+                                    size_t                      i,
+                                    external_string_type const& w) {
+                        if (i % 2 == 0) {
+                          prev[t].assign(w);
+                        } else {
+                          out[t].push_back(prev[t] == w);
+                        }
+                      });
+        result.clear();
+        result.reserve(ends.size() / 2);
+        for (auto const& o : out) {
+          result.insert(result.end(), o.cbegin(), o.cend());
+        }
+      }
+
       void set_overlap_policy(options::overlap p) {
         if (p == _kb->_settings._overlap_policy
             && _overlap_measure != nullptr) {
@@ -621,41 +1357,218 @@ namespace libsemigroups {
         }
       }
 
+      //////////////////////////////////////////////////////////////////////////
+      // KnuthBendixImpl - binary serialization - public
+      //////////////////////////////////////////////////////////////////////////
+
+      // Integers are written as 8 bytes, least significant byte first, and
+      // strings as their length followed by their bytes, so that the format
+      // does not depend on the platform.
+      static void write_integer(std::ostream& os, uint64_t val) {
+        char buf[8];
+        for (size_t i = 0; i < 8; ++i) {
+          buf[i] = static_cast<char>((val >> (8 * i)) & 0xFF);
+        }
+        os.write(buf, 8);
+      }
+
+      static uint64_t read_integer(std::istream& is) {
+        char buf[8];
+        if (!is.read(buf, 8)) {
+          LIBSEMIGROUPS_EXCEPTION("unexpected end of input");
+        }
+        uint64_t val = 0;
+        for (size_t i = 0; i < 8; ++i) {
+          val |= static_cast<uint64_t>(static_cast<unsigned char>(buf[i]))
+                 << (8 * i);
+        }
+        return val;
+      }
+
+      static void write_string(std::ostream& os, std::string const& s) {
+        write_integer(os, s.size());
+        os.write(s.data(), s.size());
+      }
+
+      static std::string read_string(std::istream& is) {
+        uint64_t    n = read_integer(is);
+        std::string s;
+        // Read in chunks so that a corrupt length does not cause a huge
+        // allocation before the end of the input is detected.
+        char buf[4096];
+        while (n > 0) {
+          size_t const m = std::min(n, static_cast<uint64_t>(sizeof(buf)));
+          if (!is.read(buf, m)) {
+            LIBSEMIGROUPS_EXCEPTION("unexpected end of input");
+          }
+          s.append(buf, m);
+          n -= m;
+        }
+        return s;
+      }
+
+      // Writes the state of the rewriting system: the active rules (in order),
+      // the rules on the stack, the deferred rules, the size of the pool of
+      // inactive rules, the positions reached in knuth_bendix and
+      // confluent(), and what is known about confluence. Rules are written
+      // using the indices of their letters, so that the output does not
+      // depend on the internal alphabet.
+      void write(std::ostream& os) const {
+        write_integer(os, _number_of_active_rules);
+        for (Rule const* rule : _active_rules) {
+          if (rule != nullptr) {
+            write_rule(os, rule);
+          }
+        }
+        std::stack<Rule*>  stack(_stack);
+        std::vector<Rule*> rules;
+        while (!stack.empty()) {
+          rules.push_back(stack.top());
+          stack.pop();
+        }
+        write_integer(os, rules.size());
+        for (auto it = rules.crbegin(); it != rules.crend(); ++it) {
+          write_rule(os, *it);
+        }
+        write_integer(os, _deferred.size());
+        _deferred.for_each(
+            [this, &os](internal_string_type const& u,
+                        internal_string_type const& v) {
+              write_word(os, u);
+              write_word(os, v);
+            });
+        write_integer(os, _inactive_rules.size());
+        write_integer(os, compacted_position(_next_rule_pos1));
+        write_integer(os, _overlaps_max_overlap);
+        write_integer(os, compacted_position(_confluence_checked_rows));
+        write_integer(os, compacted_position(_confluence_checked_cols));
+        write_integer(os, _total_rules);
+        write_integer(os, _confluent);
+        write_integer(os, _confluence_known);
+        write_integer(os, _contains_empty_string);
+      }
+
+      // Reads the state written by write into this, which must not contain
+      // any rules. The letters of the rules must be less than n.
+      void read(std::istream& is, size_t n) {
+        LIBSEMIGROUPS_ASSERT(_active_rules.empty() && _stack.empty());
+        uint64_t const number_of_active_rules = read_integer(is);
+        for (uint64_t i = 0; i < number_of_active_rules; ++i) {
+          add_rule(read_rule(is, n));
+        }
+        uint64_t const stack_size = read_integer(is);
+        for (uint64_t i = 0; i < stack_size; ++i) {
+          _stack.emplace(read_rule(is, n));
+        }
+        uint64_t const number_of_deferred_rules = read_integer(is);
+        for (uint64_t i = 0; i < number_of_deferred_rules; ++i) {
+          internal_string_type const u = read_word(is, n);
+          defer(u, read_word(is, n));
+        }
+        uint64_t const pool_size = read_integer(is);
+        for (uint64_t i = 0; i < pool_size; ++i) {
+          _inactive_rules.push_back(new Rule(this, 1));
+        }
+        std::array<size_t*, 3> pos = {&_next_rule_pos1,
+                                      &_confluence_checked_rows,
+                                      &_confluence_checked_cols};
+        for (size_t* p : pos) {
+          *p = read_integer(is);
+          if (*p > _number_of_active_rules) {
+            LIBSEMIGROUPS_EXCEPTION("invalid input, expected a position of at "
+                                    "most %llu, found %llu",
+                                    uint64_t(_number_of_active_rules),
+                                    uint64_t(*p));
+          }
+          if (p == &_next_rule_pos1) {
+            _overlaps_max_overlap = read_integer(is);
+          }
+        }
+        _total_rules = std::max(_total_rules, size_t(read_integer(is)));
+        _confluent   = read_integer(is);
+        _confluence_known      = read_integer(is);
+        _contains_empty_string = _contains_empty_string || read_integer(is);
+      }
+
      private:
       //////////////////////////////////////////////////////////////////////////
       // KnuthBendixImpl - other methods - private
       //////////////////////////////////////////////////////////////////////////
+      // Returns true if u is less than v in the reduction ordering.
+      bool less(internal_string_type const& u,
+                internal_string_type const& v) const {
+        switch (_kb->_settings._order) {
+          case options::order::weighted_shortlex: {
+            std::vector<size_t> const& weights = _kb->_settings._weights;
+            if (weights.empty()) {
+              return shortlex_compare(u, v);
+            }
+            size_t u_weight = 0, v_weight = 0;
+            for (auto const& a : u) {
+              u_weight += weights[internal_char_to_uint(a)];
+            }
+            for (auto const& a : v) {
+              v_weight += weights[internal_char_to_uint(a)];
+            }
+            return u_weight < v_weight
+                   || (u_weight == v_weight && shortlex_compare(u, v));
+          }
+          case options::order::recursive:
+            return recursive_path_compare(u, v);
+          case options::order::shortlex:
+          default:
+            return shortlex_compare(u, v);
+        }
+      }
+
       // REWRITE_FROM_LEFT from Sims, p67
-      // Caution: this uses the assumption that rules are length reducing, if it
-      // is not, then u might not have sufficient space!
-      void internal_rewrite(internal_string_type* u) const {
+      // If the reduction ordering is shortlex, then the rules are length
+      // reducing, and u is rewritten in-place. Otherwise, the right hand side
+      // of a rule can be longer than its left hand side, and u might not have
+      // sufficient space, so the part of u still to be rewritten is kept
+      // (reversed) in a separate string. The prefix of u of length
+      // <irreducible> must be irreducible, and is not checked for left hand
+      // sides.
+      void internal_rewrite(internal_string_type* u,
+                            size_t                irreducible = 0) const {
+        LIBSEMIGROUPS_ASSERT(irreducible <= u->size());
         if (u->size() < _min_length_lhs_rule) {
           return;
+        } else if (_kb->_settings._order != options::order::shortlex) {
+          internal_string_type v(u->cbegin(), u->cbegin() + irreducible);
+          v.reserve(u->size());
+          internal_string_type w(u->crbegin(), u->crend() - irreducible);
+          while (!w.empty()) {
+            v.push_back(w.back());
+            w.pop_back();
+            Rule const* rule = _rule_trie.find_suffix(v.cbegin(), v.cend());
+            if (rule != nullptr) {
+              v.erase(v.size() - rule->lhs()->size());
+              w.append(rule->rhs()->crbegin(), rule->rhs()->crend());
+            }
+          }
+          u->swap(v);
+          return;
         }
         internal_string_type::iterator const& v_begin = u->begin();
         internal_string_type::iterator        v_end
-            = u->begin() + _min_length_lhs_rule - 1;
+            = u->begin() + std::max(_min_length_lhs_rule - 1, irreducible);
         internal_string_type::iterator        w_begin = v_end;
         internal_string_type::iterator const& w_end   = u->end();
 
-        RuleLookup lookup;
-
         while (w_begin != w_end) {
           *v_end = *w_begin;
           ++v_end;
           ++w_begin;
 
-          auto it = _set_rules.find(lookup(v_begin, v_end));
-          if (it != _set_rules.end()) {
-            Rule const* rule = (*it).rule();
-            if (rule->lhs()->size() <= static_cast<size_t>(v_end - v_begin)) {
-              LIBSEMIGROUPS_ASSERT(detail::is_suffix(
-                  v_begin, v_end, rule->lhs()->cbegin(), rule->lhs()->cend()));
-              v_end -= rule->lhs()->size();
-              w_begin -= rule->rhs()->size();
-              detail::string_replace(
-                  w_begin, rule->rhs()->cbegin(), rule->rhs()->cend());
-            }
+          Rule const* rule = _rule_trie.find_suffix(v_begin, v_end);
+          if (rule != nullptr) {
+            LIBSEMIGROUPS_ASSERT(detail::is_suffix(
+                v_begin, v_end, rule->lhs()->cbegin(), rule->lhs()->cend()));
+            v_end -= rule->lhs()->size();
+            w_begin -= rule->rhs()->size();
+            detail::string_replace(
+                w_begin, rule->rhs()->cbegin(), rule->rhs()->cend());
           }
           while (w_begin != w_end
                  && _min_length_lhs_rule - 1
@@ -684,33 +1597,41 @@ namespace libsemigroups {
 
           if (*rule1->lhs() != *rule1->rhs()) {
             internal_string_type const* lhs = rule1->lhs();
-            for (auto it = _active_rules.begin(); it != _active_rules.end();) {
-              Rule* rule2 = const_cast<Rule*>(*it);
+            for (size_t i = 0; i < _active_rules.size(); ++i) {
+              Rule* rule2 = const_cast<Rule*>(_active_rules[i]);
+              if (rule2 == nullptr) {
+                continue;
+              }
               if (rule2->lhs()->find(*lhs) != external_string_type::npos) {
-                it = remove_rule(it);
+                remove_rule(i);
                 LIBSEMIGROUPS_ASSERT(*rule2->lhs() != *rule2->rhs());
-                // rule2 is added to _inactive_rules by clear_stack
-                _stack.emplace(rule2);
-              } else {
-                if (rule2->rhs()->find(*lhs) != external_string_type::npos) {
-                  internal_rewrite(rule2->rhs());
+                if (_stack.size() < _kb->_settings._max_stack_depth) {
+                  // rule2 is added to _inactive_rules by clear_stack
+                  _stack.emplace(rule2);
+                } else {
+                  defer_rule(rule2);
                 }
-                ++it;
+              } else if (rule2->rhs()->find(*lhs)
+                         != external_string_type::npos) {
+                internal_rewrite(rule2->rhs());
+                _confluence_checked_rows = 0;
+                _confluence_checked_cols = 0;
               }
             }
             add_rule(rule1);
             // rule1 is activated, we do this after removing rules that rule1
-            // makes redundant to avoid failing to insert rule1 in _set_rules
+            // makes redundant to avoid failing to insert rule1 in _rule_trie
           } else {
-            _inactive_rules.push_back(rule1);
+            release_rule(rule1);
           }
           if (_kb->report()) {
             REPORT_DEFAULT(
                 "active rules = %d, inactive rules = %d, rules defined = "
                 "%d\n",
-                _active_rules.size(),
+                _number_of_active_rules,
                 _inactive_rules.size(),
                 _total_rules);
+            report_pruning();
             REPORT_VERBOSE_DEFAULT("max stack depth        = %d\n"
                                    "max word length        = %d\n"
                                    "max active word length = %d\n"
@@ -732,7 +1653,28 @@ namespace libsemigroups {
           _stack.emplace(rule);
           clear_stack();
         } else {
-          _inactive_rules.push_back(rule);
+          release_rule(rule);
+        }
+      }
+
+      // Adds the rules in the queue of deferred rules to the system, any
+      // rules deferred while doing so are also added.
+      void process_deferred() {
+        if (!_deferred.empty()) {
+          REPORT_DEFAULT("processing %d deferred rules\n", _deferred.size());
+        }
+        while (!_deferred.empty() && !_kb->stopped()) {
+          Rule* rule = new_rule();
+          _deferred.pop(rule->_lhs, rule->_rhs);
+          push_stack(rule);
+        }
+      }
+
+      void report_pruning() const {
+        if (!_deferred.empty() || _number_of_discarded_rules != 0) {
+          REPORT_DEFAULT("deferred rules = %d, discarded inactive rules = %d\n",
+                         _deferred.size(),
+                         _number_of_discarded_rules);
         }
       }
 
@@ -758,11 +1700,17 @@ namespace libsemigroups {
                                   it,
                                   u->rhs()->cbegin(),
                                   u->rhs()->cend());  // rule = A -> Q_i
-            rule->_lhs->append(*v->rhs());            // rule = AQ_j -> Q_i
-            rule->_rhs->append(v->lhs()->cbegin() + (u->lhs()->cend() - it),
+            rule->_lhs.append(*v->rhs());             // rule = AQ_j -> Q_i
+            rule->_rhs.append(v->lhs()->cbegin() + (u->lhs()->cend() - it),
                                v->lhs()->cend());  // rule = AQ_j -> Q_iC
-            // rule is reordered during rewriting in clear_stack
-            push_stack(rule);
+            if (_kb->_settings._defer_overlap != POSITIVE_INFINITY
+                && (*_overlap_measure)(u, v, it)
+                       > _kb->_settings._defer_overlap) {
+              defer_rule(rule);
+            } else {
+              // rule is reordered during rewriting in clear_stack
+              push_stack(rule);
+            }
             // It can be that the iterator `it` is invalidated by the call to
             // push_stack (i.e. if `u` is deactivated, then rewritten, actually
             // changed, and reactivated) and that is the reason for the checks
@@ -774,15 +1722,149 @@ namespace libsemigroups {
         }
       }
 
+      // Appends to <out> the pairs of (rewritten) words arising from the
+      // overlaps of u and v that do not rewrite to the same word, or to
+      // <deferred> if the overlap is longer than allowed by the settings.
+      // Unlike overlap, this does not modify the system, and so it can be
+      // called concurrently from several threads.
+      void critical_pairs(
+          Rule const* u,
+          Rule const* v,
+          std::vector<std::pair<internal_string_type, internal_string_type>>&
+              out,
+          std::vector<std::pair<internal_string_type, internal_string_type>>&
+              deferred) const {
+        LIBSEMIGROUPS_ASSERT(u->active() && v->active());
+        auto limit
+            = u->lhs()->cend() - std::min(u->lhs()->size(), v->lhs()->size());
+        for (auto it = u->lhs()->cend() - 1;
+             it > limit
+             && (_kb->_settings._max_overlap == POSITIVE_INFINITY
+                 || (*_overlap_measure)(u, v, it)
+                        <= _kb->_settings._max_overlap);
+             --it) {
+          // Check if B = [it, u->lhs()->cend()) is a prefix of v->lhs()
+          if (detail::is_prefix(
+                  v->lhs()->cbegin(), v->lhs()->cend(), it, u->lhs()->cend())) {
+            // u = P_i = AB -> Q_i and v = P_j = BC -> Q_j
+            internal_string_type lhs(u->lhs()->cbegin(), it);  // A
+            lhs.append(*v->rhs());                              // AQ_j
+            internal_string_type rhs(*u->rhs());                // Q_i
+            rhs.append(v->lhs()->cbegin() + (u->lhs()->cend() - it),
+                       v->lhs()->cend());  // Q_iC
+            internal_rewrite(&lhs);
+            internal_rewrite(&rhs);
+            if (lhs == rhs) {
+              continue;
+            } else if (_kb->_settings._defer_overlap != POSITIVE_INFINITY
+                       && (*_overlap_measure)(u, v, it)
+                              > _kb->_settings._defer_overlap) {
+              deferred.emplace_back(std::move(lhs), std::move(rhs));
+            } else {
+              out.emplace_back(std::move(lhs), std::move(rhs));
+            }
+          }
+        }
+      }
+
+      // Parallel version of the main loop in knuth_bendix. The overlaps of
+      // the rules in the next block of active rules with every active rule
+      // before them are found and rewritten concurrently with respect to the
+      // system at the start of the block. The resulting rules are then added
+      // (and the system reduced) serially by clear_stack.
+      void parallel_overlaps() {
+        size_t const number_of_threads = _kb->_settings._max_threads;
+        size_t const block_size        = 64 * number_of_threads;
+        std::vector<
+            std::vector<std::pair<internal_string_type, internal_string_type>>>
+               pairs(number_of_threads), deferred(number_of_threads);
+        size_t nr = 0;
+
+        while (_next_rule_pos1 < _active_rules.size()
+               && _number_of_active_rules < _kb->_settings._max_rules
+               && !_kb->stopped()) {
+          size_t const first = _next_rule_pos1;
+          size_t const last
+              = std::min(first + block_size, _active_rules.size());
+          std::atomic<size_t> next(first);
+
+          // _active_rules is not modified until every thread is joined
+          auto func = [this, &pairs, &deferred, &next, last](size_t t) {
+            for (size_t i = next++; i < last; i = next++) {
+              if (_kb->dead() || _kb->timed_out()) {
+                return;
+              }
+              Rule const* rule1 = _active_rules[i];
+              if (rule1 == nullptr) {
+                continue;
+              }
+              critical_pairs(rule1, rule1, pairs[t], deferred[t]);
+              for (size_t j = 0; j < i; ++j) {
+                Rule const* rule2 = _active_rules[j];
+                if (rule2 != nullptr) {
+                  critical_pairs(rule1, rule2, pairs[t], deferred[t]);
+                  critical_pairs(rule2, rule1, pairs[t], deferred[t]);
+                }
+              }
+            }
+          };
+          std::vector<std::thread> threads;
+          for (size_t t = 0; t < number_of_threads; ++t) {
+            threads.emplace_back(func, t);
+          }
+          for (auto& thread : threads) {
+            thread.join();
+          }
+          // 2i + 1 overlaps for the i-th rule
+          nr += last * last - first * first;
+          _number_of_overlaps += last * last - first * first;
+          _next_rule_pos1 = next_active_rule(last);
+
+          for (auto& p : pairs) {
+            for (auto const& pair : p) {
+              if (_stack.size() < _kb->_settings._max_stack_depth) {
+                _stack.emplace(new_rule(pair.first.cbegin(),
+                                        pair.first.cend(),
+                                        pair.second.cbegin(),
+                                        pair.second.cend()));
+              } else {
+                defer(pair.first, pair.second);
+              }
+            }
+            p.clear();
+          }
+          for (auto& p : deferred) {
+            for (auto const& pair : p) {
+              defer(pair.first, pair.second);
+            }
+            p.clear();
+          }
+          clear_stack();
+          if (_next_rule_pos1 == _active_rules.size()) {
+            process_deferred();
+          }
+          if (nr > _kb->_settings._check_confluence_interval) {
+            if (confluent()) {
+              break;
+            }
+            nr = 0;
+          }
+        }
+      }
+
      public:
       //////////////////////////////////////////////////////////////////////////
       // KnuthBendixImpl - main methods - public
       //////////////////////////////////////////////////////////////////////////
 
       bool confluent() const {
-        if (!_stack.empty()) {
+        if (!_stack.empty() || !_deferred.empty()) {
           return false;
         }
+        // confluent() is const, and so may be called from several threads at
+        // once; the check, and the positions it resumes from, are guarded so
+        // that no thread sees _confluence_known before the check is complete.
+        std::lock_guard<std::mutex> lg(_confluence_mtx);
         if (!_confluence_known && (!_kb->running() || !_kb->stopped())) {
           LIBSEMIGROUPS_ASSERT(_stack.empty());
           _confluent        = true;
@@ -790,19 +1872,33 @@ namespace libsemigroups {
           internal_string_type word1;
           internal_string_type word2;
           size_t               seen = 0;
-
-          for (auto it1 = _active_rules.cbegin();
-               it1 != _active_rules.cend()
-               && (!_kb->running() || !_kb->stopped());
-               ++it1) {
-            Rule const* rule1 = *it1;
+          size_t const         n    = _active_rules.size();
+          // The pairs of rules in positions [0, _confluence_checked_rows) x
+          // [0, _confluence_checked_cols) are already known to be resolved,
+          // and so the rows up to _confluence_checked_rows only have to be
+          // checked against the rules added since.
+          size_t const rows = _confluence_checked_rows;
+          size_t const cols = _confluence_checked_cols;
+
+          for (size_t i = 0; i < n && (!_kb->running() || !_kb->stopped());
+               ++i) {
+            Rule const* rule1 = _active_rules[i];
+            if (rule1 == nullptr) {
+              if (i >= rows) {
+                _confluence_checked_rows = i + 1;
+                _confluence_checked_cols = n;
+              }
+              continue;
+            }
             // Seems to be much faster to do this in reverse.
-            for (auto it2 = _active_rules.crbegin();
-                 it2 != _active_rules.crend()
-                 && (!_kb->running() || !_kb->stopped());
-                 ++it2) {
+            for (size_t j = n; j > (i < rows ? cols : 0)
+                               && (!_kb->running() || !_kb->stopped());
+                 --j) {
+              Rule const* rule2 = _active_rules[j - 1];
+              if (rule2 == nullptr) {
+                continue;
+              }
               seen++;
-              Rule const* rule2 = *it2;
               for (auto it = rule1->lhs()->cend() - 1;
                    it >= rule1->lhs()->cbegin()
                    && (!_kb->running() || !_kb->stopped());
@@ -836,14 +1932,22 @@ namespace libsemigroups {
                 }
               }
             }
+            if (i >= rows && (!_kb->running() || !_kb->stopped())) {
+              // every row before i + 1 is now resolved against every rule
+              _confluence_checked_rows = i + 1;
+              _confluence_checked_cols = n;
+            }
             if (_kb->report()) {
               REPORT_DEFAULT("checked %d pairs of overlaps out of %d\n",
                              seen,
-                             _active_rules.size() * _active_rules.size());
+                             _number_of_active_rules * _number_of_active_rules);
             }
           }
           if (_kb->running() && _kb->stopped()) {
             _confluence_known = false;
+          } else {
+            _confluence_checked_rows = n;
+            _confluence_checked_cols = n;
           }
         }
         return _confluent;
@@ -858,56 +1962,81 @@ namespace libsemigroups {
           // rules in _active_rules might not define the system.
           REPORT_DEFAULT("the system is confluent already\n");
           return true;
-        } else if (_active_rules.size() >= _kb->_settings._max_rules) {
+        } else if (_number_of_active_rules >= _kb->_settings._max_rules) {
           REPORT_DEFAULT("too many rules\n");
           return false;
         }
-        // Reduce the rules
-        _next_rule_it1 = _active_rules.begin();
-        while (_next_rule_it1 != _active_rules.end() && !_kb->stopped()) {
-          // Copy *_next_rule_it1 and push_stack so that it is not modified by
-          // the call to clear_stack.
-          LIBSEMIGROUPS_ASSERT((*_next_rule_it1)->lhs()
-                               != (*_next_rule_it1)->rhs());
-          push_stack(new_rule(*_next_rule_it1));
-          ++_next_rule_it1;
-        }
-        _next_rule_it1 = _active_rules.begin();
-        size_t nr      = 0;
-        while (_next_rule_it1 != _active_rules.cend()
-               && _active_rules.size() < _kb->_settings._max_rules
-               && !_kb->stopped()) {
-          Rule const* rule1 = *_next_rule_it1;
-          _next_rule_it2    = _next_rule_it1;
-          ++_next_rule_it1;
-          overlap(rule1, rule1);
-          while (_next_rule_it2 != _active_rules.begin() && rule1->active()) {
-            --_next_rule_it2;
-            Rule const* rule2 = *_next_rule_it2;
-            overlap(rule1, rule2);
-            ++nr;
-            if (rule1->active() && rule2->active()) {
+        // Reduce the rules, _next_rule_pos2 is used here since it is kept
+        // up to date by compact_active_rules.
+        _next_rule_pos2 = next_active_rule(0);
+        while (_next_rule_pos2 < _active_rules.size() && !_kb->stopped()) {
+          // Copy _active_rules[_next_rule_pos2] and push_stack so that it is
+          // not modified by the call to clear_stack.
+          LIBSEMIGROUPS_ASSERT(*_active_rules[_next_rule_pos2]->lhs()
+                               != *_active_rules[_next_rule_pos2]->rhs());
+          push_stack(new_rule(_active_rules[_next_rule_pos2]));
+          _next_rule_pos2 = next_active_rule(_next_rule_pos2 + 1);
+        }
+        // The overlaps of every pair of rules before _next_rule_pos1 of length
+        // at most _overlaps_max_overlap were considered by a previous call
+        // (possibly before save and load), and so we resume from there, unless
+        // longer overlaps must now be considered.
+        if (_kb->_settings._max_overlap > _overlaps_max_overlap) {
+          _next_rule_pos1 = 0;
+        }
+        _overlaps_max_overlap = _kb->_settings._max_overlap;
+        _next_rule_pos1       = next_active_rule(_next_rule_pos1);
+        if (_kb->_settings._max_threads > 1) {
+          parallel_overlaps();
+        } else {
+          size_t nr = 0;
+          while (_next_rule_pos1 < _active_rules.size()
+                 && _number_of_active_rules < _kb->_settings._max_rules
+                 && !_kb->stopped()) {
+            Rule const* rule1 = _active_rules[_next_rule_pos1];
+            LIBSEMIGROUPS_ASSERT(rule1 != nullptr);
+            _next_rule_pos2   = _next_rule_pos1;
+            _next_rule_pos1   = next_active_rule(_next_rule_pos1 + 1);
+            overlap(rule1, rule1);
+            ++_number_of_overlaps;
+            while (rule1->active()) {
+              _next_rule_pos2 = prev_active_rule(_next_rule_pos2);
+              if (_next_rule_pos2 == UNDEFINED) {
+                break;
+              }
+              Rule const* rule2 = _active_rules[_next_rule_pos2];
+              overlap(rule1, rule2);
               ++nr;
-              overlap(rule2, rule1);
+              ++_number_of_overlaps;
+              if (rule1->active() && rule2->active()) {
+                ++nr;
+                ++_number_of_overlaps;
+                overlap(rule2, rule1);
+              }
             }
-          }
-          if (nr > _kb->_settings._check_confluence_interval) {
-            if (confluent()) {
-              break;
+            if (nr > _kb->_settings._check_confluence_interval) {
+              if (confluent()) {
+                break;
+              }
+              nr = 0;
+            }
+            if (_next_rule_pos1 == _active_rules.size()) {
+              clear_stack();
+              process_deferred();
             }
-            nr = 0;
-          }
-          if (_next_rule_it1 == _active_rules.cend()) {
-            clear_stack();
           }
         }
+        if (_next_rule_pos1 >= _active_rules.size()) {
+          // Every overlap has been considered, the next call starts again.
+          _next_rule_pos1 = 0;
+        }
         // LIBSEMIGROUPS_ASSERT(_stack.empty());
         // Seems that the stack can be non-empty here in KnuthBendix 12, 14, 16
         // and maybe more
         bool ret;
         if (_kb->_settings._max_overlap == POSITIVE_INFINITY
             && _kb->_settings._max_rules == POSITIVE_INFINITY
-            && !_kb->stopped()) {
+            && _deferred.empty() && !_kb->stopped()) {
           _confluence_known = true;
           _confluent        = true;
           for (Rule* rule : _inactive_rules) {
@@ -921,9 +2050,10 @@ namespace libsemigroups {
 
         REPORT_DEFAULT("stopping with active rules = %d, inactive rules = %d, "
                        "rules defined = %d\n",
-                       _active_rules.size(),
+                       _number_of_active_rules,
                        _inactive_rules.size(),
                        _total_rules);
+        report_pruning();
         REPORT_VERBOSE_DEFAULT("max stack depth = %d", _max_stack_depth);
         REPORT_TIME(timer);
         return ret;
@@ -956,7 +2086,7 @@ namespace libsemigroups {
       struct IteratorMethods {
         external_rule_type
         indirection(KnuthBendixImpl*                       kbi,
-                    std::list<Rule const*>::const_iterator it) const {
+                    std::vector<Rule const*>::const_iterator it) const {
           auto lhs = std::string(*(*it)->lhs());
           auto rhs = std::string(*(*it)->rhs());
           kbi->internal_to_external_string(lhs);
@@ -968,7 +2098,7 @@ namespace libsemigroups {
         // Not defined!
         external_rule_type const*
         addressof(KnuthBendixImpl*,
-                  std::list<Rule const*>::const_iterator) const {
+                  std::vector<Rule const*>::const_iterator) const {
           return nullptr;
         }
       };
@@ -981,7 +2111,7 @@ namespace libsemigroups {
       /*using const_iterator = detail::ConstIteratorStateful<
           KnuthBendixImpl const*,                  // state
           IteratorMethods,                        // methods
-          std::list<Rule const*>::const_iterator,  // wrapped iterator
+          std::vector<Rule const*>::const_iterator,  // wrapped iterator
           external_rule_type,                      // external value type
           external_rule_type,                      // external const pointer
           external_rule_type&&                     // external const reference
@@ -1000,18 +2130,26 @@ namespace libsemigroups {
       // KnuthBendixImpl - data - private
       ////////////////////////////////////////////////////////////////////////
 
-      std::list<Rule const*>           _active_rules;
+      std::vector<Rule const*>         _active_rules;
       mutable std::atomic<bool>        _confluent;
       mutable std::atomic<bool>        _confluence_known;
+      mutable size_t                   _confluence_checked_cols;
+      mutable size_t                   _confluence_checked_rows;
+      mutable std::mutex               _confluence_mtx;
       mutable std::list<Rule*>         _inactive_rules;
       bool                             _internal_is_same_as_external;
       bool                             _contains_empty_string;
+      DeferredQueue                    _deferred;
       KnuthBendix*                     _kb;
       size_t                           _min_length_lhs_rule;
-      std::list<Rule const*>::iterator _next_rule_it1;
-      std::list<Rule const*>::iterator _next_rule_it2;
+      size_t                           _next_rule_pos1;
+      size_t                           _next_rule_pos2;
+      size_t                           _number_of_active_rules;
+      size_t                           _number_of_discarded_rules;
+      size_t                           _number_of_overlaps;
       OverlapMeasure*                  _overlap_measure;
-      std::set<RuleLookup>             _set_rules;
+      size_t                           _overlaps_max_overlap;
+      RuleTrie                         _rule_trie;
       std::stack<Rule*>                _stack;
       internal_string_type*            _tmp_word1;
       internal_string_type*            _tmp_word2;
@@ -1023,14 +2161,11 @@ namespace libsemigroups {
       //////////////////////////////////////////////////////////////////////////
 
       size_t max_active_word_length() {
-        auto comp = [](Rule const* p, Rule const* q) -> bool {
-          return p->lhs()->size() < q->lhs()->size();
-        };
-        auto max = std::max_element(
-            _active_rules.cbegin(), _active_rules.cend(), comp);
-        if (max != _active_rules.cend()) {
-          _max_active_word_length
-              = std::max(_max_active_word_length, (*max)->lhs()->size());
+        for (Rule const* rule : _active_rules) {
+          if (rule != nullptr) {
+            _max_active_word_length
+                = std::max(_max_active_word_length, rule->lhs()->size());
+          }
         }
         return _max_active_word_length;
       }
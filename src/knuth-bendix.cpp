@@ -16,11 +16,18 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-#include <cstddef>  // for size_t
-#include <string>   // for string
+#include <algorithm>  // for equal, find
+#include <array>      // for array
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint64_t
+#include <istream>    // for istream
+#include <set>        // for multiset
+#include <string>     // for string
+#include <vector>     // for vector
 
 #include "libsemigroups/cong-intf.hpp"  // for CongruenceInterface, CongruenceInterface::...
 #include "libsemigroups/debug.hpp"              // for LIBSEMIGROUPS_ASSERT
+#include "libsemigroups/digraph-helper.hpp"     // for is_acyclic
 #include "libsemigroups/digraph.hpp"            // for ActionDigraph
 #include "libsemigroups/exception.hpp"          // for LIBSEMIGROUPS_EXCEPTION
 #include "libsemigroups/fpsemi-intf.hpp"        // for FpSemigroupInterface
@@ -29,6 +36,7 @@
 #include "libsemigroups/kbe.hpp"                // for detail::KBE
 #include "libsemigroups/knuth-bendix.hpp"       // for KnuthBendix, KnuthBe...
 #include "libsemigroups/obvinf.hpp"             // for IsObviouslyInfinitePairs
+#include "libsemigroups/tce.hpp"                // for detail::TCE
 #include "libsemigroups/types.hpp"              // for word_type
 
 #include "knuth-bendix-impl.hpp"
@@ -42,26 +50,6 @@ namespace libsemigroups {
       = FroidurePin<detail::KBE,
                     FroidurePinTraits<detail::KBE, fpsemigroup::KnuthBendix>>;
 
-  namespace {
-    bool is_subword(std::string const& x, std::string const& y) {
-      return y.find(x) != std::string::npos;
-    }
-
-    void prefixes_string(std::unordered_map<std::string, size_t>& st,
-                         std::string const&                       x,
-                         size_t&                                  n) {
-      for (auto it = x.cbegin() + 1; it < x.cend(); ++it) {
-        auto w   = std::string(x.cbegin(), it);
-        auto wit = st.find(w);
-        if (wit == st.end()) {
-          st.emplace(w, n);
-          n++;
-        }
-      }
-    }
-
-  }  // namespace
-
   namespace fpsemigroup {
 
     //////////////////////////////////////////////////////////////////////////
@@ -70,9 +58,16 @@ namespace libsemigroups {
 
     KnuthBendix::Settings::Settings()
         : _check_confluence_interval(4096),
+          _defer_overlap(POSITIVE_INFINITY),
+          _defer_to_disk(false),
+          _max_inactive_rules(POSITIVE_INFINITY),
           _max_overlap(POSITIVE_INFINITY),
           _max_rules(POSITIVE_INFINITY),
-          _overlap_policy(options::overlap::ABC) {}
+          _max_stack_depth(POSITIVE_INFINITY),
+          _max_threads(1),
+          _order(options::order::shortlex),
+          _overlap_policy(options::overlap::ABC),
+          _weights() {}
 
     //////////////////////////////////////////////////////////////////////////
     // KnuthBendix - setters for Settings - public
@@ -85,6 +80,45 @@ namespace libsemigroups {
       return *this;
     }
 
+    KnuthBendix& KnuthBendix::order(options::order val) {
+      if (started()) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "cannot change the reduction ordering at this stage");
+      }
+      _settings._order = val;
+      // the next line must be after _settings._order is set
+      _impl->reorder_rules();
+      return *this;
+    }
+
+    KnuthBendix& KnuthBendix::weights(std::vector<size_t> const& val) {
+      if (started()) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "cannot change the reduction ordering at this stage");
+      } else if (val.size() != alphabet().size()) {
+        LIBSEMIGROUPS_EXCEPTION("expected %llu weights, found %llu",
+                                uint64_t(alphabet().size()),
+                                uint64_t(val.size()));
+      }
+      auto it = std::find(val.cbegin(), val.cend(), 0);
+      if (it != val.cend()) {
+        LIBSEMIGROUPS_EXCEPTION("expected positive weights, found 0 in "
+                                "position %llu",
+                                uint64_t(it - val.cbegin()));
+      }
+      _settings._weights = val;
+      if (_settings._order == options::order::weighted_shortlex) {
+        _impl->reorder_rules();
+      }
+      return *this;
+    }
+
+    KnuthBendix& KnuthBendix::max_inactive_rules(size_t val) {
+      _settings._max_inactive_rules = val;
+      _impl->prune_inactive_rules();
+      return *this;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     // KnuthBendix - constructors and destructor - public
     //////////////////////////////////////////////////////////////////////////
@@ -118,6 +152,10 @@ namespace libsemigroups {
 
     void KnuthBendix::init_from(KnuthBendix const& kb, bool add) {
       // TODO(later)   set confluence if known? Other things?
+      // The ordering is copied before the rules so that the rules are oriented
+      // in the same way as in kb.
+      _settings._order   = kb._settings._order;
+      _settings._weights = kb._settings._weights;
       if (!kb.alphabet().empty()) {
         if (alphabet().empty()) {
           set_alphabet(kb.alphabet());
@@ -125,10 +163,52 @@ namespace libsemigroups {
         // throws if rules contain letters that are not in the alphabet.
         if (add) {
           add_rules(kb.active_rules());
+          // The deferred rules are consequences of the rules of kb that are
+          // not consequences of its active rules.
+          _impl->add_deferred_rules(kb._impl.get());
         }
       }
       // TODO(later) copy other settings
-      _settings._overlap_policy = kb._settings._overlap_policy;
+      _settings._overlap_policy     = kb._settings._overlap_policy;
+      _settings._max_threads        = kb._settings._max_threads;
+      _settings._defer_overlap      = kb._settings._defer_overlap;
+      _settings._defer_to_disk      = kb._settings._defer_to_disk;
+      _settings._max_inactive_rules = kb._settings._max_inactive_rules;
+      _settings._max_stack_depth    = kb._settings._max_stack_depth;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // KnuthBendix - validation - private
+    //////////////////////////////////////////////////////////////////////////
+
+    void KnuthBendix::validate_words(std::string const&         words,
+                                     std::vector<size_t> const& ends) const {
+      size_t prev = 0;
+      for (size_t const end : ends) {
+        if (end < prev) {
+          LIBSEMIGROUPS_EXCEPTION("expected the ends of the words to be "
+                                  "non-decreasing, found %llu after %llu",
+                                  uint64_t(end),
+                                  uint64_t(prev));
+        }
+        prev = end;
+      }
+      if (prev != words.size()) {
+        LIBSEMIGROUPS_EXCEPTION("expected the last word to end at %llu (the "
+                                "length of the words), found %llu",
+                                uint64_t(words.size()),
+                                uint64_t(prev));
+      }
+      // Avoid calling validate_letter for every letter
+      std::array<bool, 256> valid = {};
+      for (char const c : alphabet()) {
+        valid[static_cast<unsigned char>(c)] = true;
+      }
+      for (char const c : words) {
+        if (!valid[static_cast<unsigned char>(c)]) {
+          validate_letter(c);  // throws
+        }
+      }
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -236,10 +316,177 @@ namespace libsemigroups {
       }
     }
 
+    void KnuthBendix::normal_forms(std::string const&         words,
+                                   std::vector<size_t> const& ends,
+                                   std::string&               result,
+                                   std::vector<size_t>&       result_ends) {
+      validate_words(words, ends);
+      run();
+      _impl->normal_forms(words, ends, result, result_ends);
+    }
+
+    void KnuthBendix::equal_to(std::string const&         words,
+                               std::vector<size_t> const& ends,
+                               std::vector<bool>&         result) {
+      if (ends.size() % 2 != 0) {
+        LIBSEMIGROUPS_EXCEPTION("expected an even number of words, found %llu",
+                                uint64_t(ends.size()));
+      }
+      validate_words(words, ends);
+      run();
+      _impl->equal_to(words, ends, result);
+    }
+
     size_t KnuthBendix::number_of_active_rules() const noexcept {
       return _impl->number_of_rules();
     }
 
+    size_t KnuthBendix::number_of_deferred_rules() const noexcept {
+      return _impl->number_of_deferred_rules();
+    }
+
+    size_t KnuthBendix::number_of_overlaps() const noexcept {
+      return _impl->number_of_overlaps();
+    }
+
+    namespace {
+      // The first 8 bytes of the output of KnuthBendix::save, followed by the
+      // version of the format.
+      constexpr char     KB_MAGIC[] = "LSGKB\x00\x00\x00";
+      constexpr uint64_t KB_VERSION = 4;
+    }  // namespace
+
+    void KnuthBendix::save(std::ostream& os) const {
+      using impl = KnuthBendixImpl;
+      os.write(KB_MAGIC, 8);
+      impl::write_integer(os, KB_VERSION);
+      impl::write_integer(os, _settings._check_confluence_interval);
+      impl::write_integer(os, _settings._max_overlap);
+      impl::write_integer(os, _settings._max_rules);
+      impl::write_integer(os, _settings._max_threads);
+      impl::write_integer(os, _settings._defer_overlap);
+      impl::write_integer(os, _settings._defer_to_disk);
+      impl::write_integer(os, _settings._max_inactive_rules);
+      impl::write_integer(os, _settings._max_stack_depth);
+      impl::write_integer(os, static_cast<uint64_t>(_settings._overlap_policy));
+      impl::write_integer(os, static_cast<uint64_t>(_settings._order));
+      impl::write_integer(os, _settings._weights.size());
+      for (size_t const w : _settings._weights) {
+        impl::write_integer(os, w);
+      }
+      impl::write_string(os, alphabet());
+      impl::write_integer(os, has_identity());
+      impl::write_string(os, has_identity() ? identity() : "");
+      impl::write_string(os, has_inverses() ? inverses() : "");
+      impl::write_integer(os, number_of_rules());
+      for (auto it = cbegin_rules(); it != cend_rules(); ++it) {
+        impl::write_string(os, it->first);
+        impl::write_string(os, it->second);
+      }
+      _impl->write(os);
+    }
+
+    void KnuthBendix::load(std::istream& is) {
+      using impl = KnuthBendixImpl;
+      if (!alphabet().empty() || number_of_rules() != 0) {
+        LIBSEMIGROUPS_EXCEPTION("cannot load into a KnuthBendix instance "
+                                "whose alphabet or rules have been set");
+      }
+      char magic[8];
+      if (!is.read(magic, 8) || !std::equal(magic, magic + 8, KB_MAGIC)) {
+        LIBSEMIGROUPS_EXCEPTION("invalid input, not the output of "
+                                "KnuthBendix::save");
+      }
+      uint64_t const version = impl::read_integer(is);
+      if (version != KB_VERSION) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "invalid input, expected version %llu, found %llu",
+            uint64_t(KB_VERSION),
+            version);
+      }
+      size_t const   interval = impl::read_integer(is);
+      size_t const   overlap  = impl::read_integer(is);
+      size_t const   nr_rules = impl::read_integer(is);
+      size_t const   threads  = impl::read_integer(is);
+      size_t const   defer    = impl::read_integer(is);
+      bool const     to_disk  = impl::read_integer(is);
+      size_t const   inactive = impl::read_integer(is);
+      size_t const   depth    = impl::read_integer(is);
+      uint64_t const policy   = impl::read_integer(is);
+      if (policy > static_cast<uint64_t>(options::overlap::MAX_AB_BC)) {
+        LIBSEMIGROUPS_EXCEPTION("invalid input, unknown overlap policy %llu",
+                                policy);
+      }
+      uint64_t const order = impl::read_integer(is);
+      if (order > static_cast<uint64_t>(options::order::recursive)) {
+        LIBSEMIGROUPS_EXCEPTION("invalid input, unknown ordering %llu", order);
+      }
+      uint64_t const      nr_weights = impl::read_integer(is);
+      std::vector<size_t> wts;
+      for (uint64_t i = 0; i < nr_weights; ++i) {
+        wts.push_back(impl::read_integer(is));
+      }
+      std::string const lphbt       = impl::read_string(is);
+      bool const        has_id      = impl::read_integer(is);
+      std::string const id          = impl::read_string(is);
+      std::string const invrss      = impl::read_string(is);
+      uint64_t const    nr_of_rules = impl::read_integer(is);
+      std::vector<std::pair<std::string, std::string>> rules;
+      for (uint64_t i = 0; i < nr_of_rules; ++i) {
+        std::string u = impl::read_string(is);
+        rules.emplace_back(std::move(u), impl::read_string(is));
+      }
+
+      if ((!wts.empty() && wts.size() != lphbt.size())
+          || std::find(wts.cbegin(), wts.cend(), 0) != wts.cend()) {
+        LIBSEMIGROUPS_EXCEPTION("invalid input, invalid weights");
+      }
+
+      // The ordering is set directly, since the setters would reorder the
+      // rules of _impl, which is replaced below anyway.
+      _settings._order   = static_cast<options::order>(order);
+      _settings._weights = wts;
+      if (!lphbt.empty()) {
+        set_alphabet(lphbt);
+      }
+      if (has_id) {
+        set_identity(id);
+      }
+      if (!invrss.empty()) {
+        set_inverses(invrss);
+      }
+      // The saved rules include those added by set_identity and set_inverses,
+      // which should not be added twice.
+      std::multiset<std::pair<std::string, std::string>> added(cbegin_rules(),
+                                                              cend_rules());
+      for (auto const& rule : rules) {
+        auto it = added.find(rule);
+        if (it != added.cend()) {
+          added.erase(it);
+        } else {
+          add_rule(rule);  // throws if the rule contains invalid letters
+        }
+      }
+
+      // The rules added above are already contained in the saved state of the
+      // rewriting system, and so we replace _impl.
+      // The deferred rules are stored according to _defer_to_disk when read.
+      defer_to_disk(to_disk);
+      auto kb = std::make_unique<KnuthBendixImpl>(this);
+      kb->set_internal_alphabet(alphabet());
+      kb->read(is, alphabet().size());
+      _impl = std::move(kb);
+
+      check_confluence_interval(interval);
+      max_overlap(overlap);
+      max_rules(nr_rules);
+      max_threads(threads);
+      defer_overlap(defer);
+      max_inactive_rules(inactive);
+      max_stack_depth(depth);
+      overlap_policy(static_cast<options::overlap>(policy));
+    }
+
     ActionDigraph<size_t> const& KnuthBendix::gilman_digraph() {
       if (_gilman_digraph.number_of_nodes() == 0) {
         // reset the settings so that we really run!
@@ -247,48 +494,39 @@ namespace libsemigroups {
         run();
         LIBSEMIGROUPS_ASSERT(finished());
         LIBSEMIGROUPS_ASSERT(confluent());
-        std::unordered_map<std::string, size_t> prefixes;
-        prefixes.emplace("", 0);
-        // FIXME(later)
-        auto rules = active_rules();
-
-        size_t n = 1;
-        for (auto const& rule : rules) {
-          prefixes_string(prefixes, rule.first, n);
-        }
-
-        _gilman_digraph.add_nodes(prefixes.size());
-        _gilman_digraph.add_to_out_degree(alphabet().size());
-
-        for (auto& p : prefixes) {
-          for (size_t i = 0; i < alphabet().size(); ++i) {
-            auto s  = p.first + alphabet()[i];
-            auto it = prefixes.find(s);
-            if (it != prefixes.end()) {
-              _gilman_digraph.add_edge(p.second, it->second, i);
-            } else {
-              if (!std::any_of(
-                      rules.cbegin(),
-                      rules.cend(),
-                      [&s](std::pair<std::string, std::string> const& rule) {
-                        return is_subword(rule.first, s);
-                      })) {
-                while (!s.empty()) {
-                  s  = std::string(s.begin() + 1, s.end());
-                  it = prefixes.find(s);
-                  if (it != prefixes.end()) {
-                    _gilman_digraph.add_edge(p.second, it->second, i);
-                    break;
-                  }
-                }
-              }
-            }
-          }
-        }
+        _impl->gilman_digraph(_gilman_digraph);
       }
       return _gilman_digraph;
     }
 
+    std::shared_ptr<FroidurePinBase>
+    KnuthBendix::froidure_pin_from_gilman_digraph() {
+      using detail::TCE;
+      using table_type = TCE::Table;
+      if (alphabet().empty()) {
+        LIBSEMIGROUPS_EXCEPTION("no alphabet has been defined");
+      }
+      auto const& ad = gilman_digraph();
+      if (!action_digraph_helper::is_acyclic(ad)) {
+        LIBSEMIGROUPS_EXCEPTION("the semigroup defined by the rules is "
+                                "infinite");
+      }
+      auto                table = std::make_shared<table_type>();
+      std::vector<size_t> gens;
+      if (!_impl->right_cayley_graph(ad, *table, gens)) {
+        auto ptr = froidure_pin();
+        ptr->run();
+        return ptr;
+      }
+      auto ptr = std::make_shared<
+          FroidurePin<TCE, FroidurePinTraits<TCE, table_type>>>(table);
+      for (size_t const i : gens) {
+        ptr->add_generator(TCE(i));
+      }
+      ptr->run();
+      return ptr;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     // FpSemigroupInterface - pure virtual methods - private
     //////////////////////////////////////////////////////////////////////////
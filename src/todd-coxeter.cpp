@@ -28,6 +28,7 @@
 #include <numeric>    // for iota
 #include <random>     // for mt19937
 #include <string>     // for operator+, basic_string
+#include <thread>     // for thread
 #include <utility>    // for pair
 
 #ifdef LIBSEMIGROUPS_DEBUG
@@ -48,6 +49,7 @@
 #include "libsemigroups/tce.hpp"                // for TCE
 #include "libsemigroups/timer.hpp"              // for detail::Timer
 #include "libsemigroups/types.hpp"              // for letter_type
+#include "libsemigroups/uf.hpp"                 // for Duf
 
 // TODO(later)
 //
@@ -217,6 +219,43 @@ namespace libsemigroups {
       return (r == c ? d : (r == d ? c : r));
     }
 
+    // Replace table by the table whose row c is row p[c] of table, and where
+    // the entries in the rows that become the first number_of_active rows are
+    // relabelled by q. This is done in place, so that no second table is
+    // allocated: each of the number_of_threads threads relabels the entries
+    // of a contiguous block of rows, and then the rows are permuted by
+    // following the cycles of p.
+    static void permute_table(ToddCoxeter::table_type&       table,
+                              std::vector<coset_type> const& p,
+                              std::vector<coset_type> const& q,
+                              size_t const                   number_of_active,
+                              size_t const number_of_threads) {
+      auto func = [&table, &q, &number_of_active](size_t first, size_t last) {
+        size_t const n = table.number_of_cols();
+        for (size_t c = first; c < last; ++c) {
+          if (q[c] < number_of_active) {
+            for (size_t x = 0; x < n; ++x) {
+              coset_type const i = table.get(c, x);
+              if (i != UNDEFINED) {
+                table.set(c, x, q[i]);
+              }
+            }
+          }
+        }
+      };
+      size_t const             m = p.size();
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < number_of_threads; ++i) {
+        threads.emplace_back(func,
+                             (i * m) / number_of_threads,
+                             ((i + 1) * m) / number_of_threads);
+      }
+      for (auto& t : threads) {
+        t.join();
+      }
+      table.apply_row_permutation(p);
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // ToddCoxeter - inner classes - private
     ////////////////////////////////////////////////////////////////////////
@@ -227,13 +266,17 @@ namespace libsemigroups {
 #ifdef LIBSEMIGROUPS_DEBUG
             enable_debug_verify_no_missing_deductions(true),
 #endif
+            concurrency_threshold(1000000),
+            large_collapse(100000),
             lookahead(options::lookahead::partial),
             lower_bound(UNDEFINED),
+            max_threads(std::max(1u, std::thread::hardware_concurrency())),
             next_lookahead(5000000),
             froidure_pin(options::froidure_pin::none),
             random_interval(200000000),
             save(false),
             standardize(false),
+            store_preimages(true),
             strategy(options::strategy::hlt) {
       }
 
@@ -242,13 +285,17 @@ namespace libsemigroups {
 #ifdef LIBSEMIGROUPS_DEBUG
       bool enable_debug_verify_no_missing_deductions;
 #endif
+      size_t                   concurrency_threshold;
+      size_t                   large_collapse;
       options::lookahead       lookahead;
       size_t                   lower_bound;
+      size_t                   max_threads;
       size_t                   next_lookahead;
       options::froidure_pin    froidure_pin;
       std::chrono::nanoseconds random_interval;
       bool                     save;
       bool                     standardize;
+      bool                     store_preimages;
       options::strategy        strategy;
     };
 
@@ -372,6 +419,8 @@ namespace libsemigroups {
           _deduct(),
           _extra(),
           _felsch_tree(nullptr),
+          _large_collapse_uf(),
+          _large_collapse_min(),
           _nr_pairs_added_earlier(0),
           _prefilled(false),
           _preim_init(0, 0, UNDEFINED),
@@ -381,6 +430,7 @@ namespace libsemigroups {
           _standardized(order::none),
           _state(state::constructed),
           _table(0, 0, UNDEFINED),
+          _track_preimages(true),
           _tree(nullptr) {}
 
     ToddCoxeter::ToddCoxeter(ToddCoxeter const& copy)
@@ -390,6 +440,8 @@ namespace libsemigroups {
           _deduct(copy._deduct),
           _extra(copy._extra),
           _felsch_tree(nullptr),
+          _large_collapse_uf(),
+          _large_collapse_min(),
           _nr_pairs_added_earlier(copy._nr_pairs_added_earlier),
           _prefilled(copy._prefilled),
           _preim_init(copy._preim_init),
@@ -399,6 +451,7 @@ namespace libsemigroups {
           _standardized(copy._standardized),
           _state(copy._state),
           _table(copy._table),
+          _track_preimages(copy._track_preimages),
           _tree(nullptr) {
       if (copy._felsch_tree != nullptr) {
         _felsch_tree = std::make_unique<FelschTree>(*copy._felsch_tree);
@@ -510,6 +563,10 @@ namespace libsemigroups {
       return *this;
     }
 
+    ToddCoxeter::options::lookahead ToddCoxeter::lookahead() const noexcept {
+      return _settings->lookahead;
+    }
+
     ToddCoxeter& ToddCoxeter::lower_bound(size_t n) noexcept {
       _settings->lower_bound = n;
       return *this;
@@ -520,6 +577,28 @@ namespace libsemigroups {
       return *this;
     }
 
+    size_t ToddCoxeter::next_lookahead() const noexcept {
+      return _settings->next_lookahead;
+    }
+
+    ToddCoxeter& ToddCoxeter::large_collapse(size_t n) noexcept {
+      _settings->large_collapse = n;
+      return *this;
+    }
+
+    size_t ToddCoxeter::large_collapse() const noexcept {
+      return _settings->large_collapse;
+    }
+
+    ToddCoxeter& ToddCoxeter::store_preimages(bool x) noexcept {
+      _settings->store_preimages = x;
+      return *this;
+    }
+
+    bool ToddCoxeter::store_preimages() const noexcept {
+      return _settings->store_preimages;
+    }
+
     ToddCoxeter& ToddCoxeter::standardize(bool x) noexcept {
       _settings->standardize = x;
       return *this;
@@ -540,6 +619,10 @@ namespace libsemigroups {
       return *this;
     }
 
+    bool ToddCoxeter::save() const noexcept {
+      return _settings->save;
+    }
+
     ToddCoxeter& ToddCoxeter::strategy(options::strategy x) {
       if ((_prefilled
            || (has_parent_froidure_pin()
@@ -565,6 +648,24 @@ namespace libsemigroups {
       return *this;
     }
 
+    ToddCoxeter& ToddCoxeter::max_threads(size_t val) noexcept {
+      _settings->max_threads = (val == 0 ? 1 : val);
+      return *this;
+    }
+
+    size_t ToddCoxeter::max_threads() const noexcept {
+      return _settings->max_threads;
+    }
+
+    ToddCoxeter& ToddCoxeter::concurrency_threshold(size_t val) noexcept {
+      _settings->concurrency_threshold = val;
+      return *this;
+    }
+
+    size_t ToddCoxeter::concurrency_threshold() const noexcept {
+      return _settings->concurrency_threshold;
+    }
+
     ToddCoxeter& ToddCoxeter::sort_generating_pairs(
         std::function<bool(word_type const&, word_type const&)> func) {
       if (started()) {
@@ -608,8 +709,10 @@ namespace libsemigroups {
       if (n > m) {
         m = n - m;
         _table.add_rows(m);
-        _preim_init.add_rows(m);
-        _preim_next.add_rows(m);
+        if (_track_preimages) {
+          _preim_init.add_rows(m);
+          _preim_next.add_rows(m);
+        }
         add_free_cosets(m);
       }
     }
@@ -652,6 +755,10 @@ namespace libsemigroups {
       return true;
     }
 
+    size_t ToddCoxeter::number_of_borrowed_rows() const noexcept {
+      return _table.number_of_shared_rows();
+    }
+
     bool ToddCoxeter::compatible() const noexcept {
       coset_type c = _id_coset;
       while (c != first_free_coset()) {
@@ -737,8 +844,9 @@ namespace libsemigroups {
       run();
       standardize(order::shortlex);
       shrink_to_fit();
+      _table.unshare();
       // Ensure class indices and letters are equal!
-      auto   table = std::make_shared<table_type>(_table);
+      auto   table = std::make_shared<table_type>(_table.array());
       size_t n     = number_of_generators();
       for (letter_type a = 0; a < n;) {
         if (table->get(0, a) != a + 1) {
@@ -764,6 +872,16 @@ namespace libsemigroups {
             "there are infinitely many classes in the congruence and "
             "Todd-Coxeter will never terminate");
       }
+      if (!_settings->store_preimages
+          && (_settings->strategy != options::strategy::hlt || _settings->save
+              || _settings->standardize)) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "preimages can only be omitted when using the HLT strategy "
+            "without saving or standardizing");
+      } else if (_settings->store_preimages && !_track_preimages) {
+        _track_preimages = true;
+        rebuild_preimages();
+      }
       if (_settings->lower_bound != UNDEFINED) {
         size_t const bound     = _settings->lower_bound;
         _settings->lower_bound = UNDEFINED;
@@ -776,6 +894,8 @@ namespace libsemigroups {
         hlt();
       } else if (_settings->strategy == options::strategy::random) {
         sims();
+      } else if (_settings->strategy == options::strategy::adaptive) {
+        adaptive();
       }
     }
 
@@ -844,7 +964,7 @@ namespace libsemigroups {
       // TODO(later) add columns to make it up to n?
       _preim_init = table_type(n, 1, UNDEFINED);
       _preim_next = table_type(n, 1, UNDEFINED);
-      _table      = table_type(n, 1, UNDEFINED);
+      _table = detail::CopyOnWriteArray2<coset_type>(n, 1, UNDEFINED);
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -909,6 +1029,11 @@ namespace libsemigroups {
     }
 
     void ToddCoxeter::init() {
+      if (_table.shared_array_modified()) {
+        // Generators were added to parent_froidure_pin() after the table was
+        // prefilled, so stop borrowing its rows.
+        _table.unshare();
+      }
       if (_state == state::constructed) {
         REPORT_DEBUG_DEFAULT("initializing...\n");
         // Add the relations/Cayley graph from parent() if any.
@@ -918,12 +1043,7 @@ namespace libsemigroups {
               || _settings->froidure_pin == options::froidure_pin::none) {
             REPORT_DEBUG_DEFAULT("using Cayley graph...\n");
             LIBSEMIGROUPS_ASSERT(_relations.empty());
-            prefill(*parent_froidure_pin());
-#ifdef LIBSEMIGROUPS_DEBUG
-            // This is a check of program logic, since we use parent() to fill
-            // the table, so we only validate in debug mode.
-            validate_table(_table, 1, parent_froidure_pin()->size() + 1);
-#endif
+            prefill(parent_froidure_pin());
           } else {
             REPORT_DEBUG_DEFAULT("using presentation...\n");
             LIBSEMIGROUPS_ASSERT(_settings->froidure_pin
@@ -993,22 +1113,46 @@ namespace libsemigroups {
       }
     }
 
-    void ToddCoxeter::prefill(FroidurePinBase& S) {
+    void ToddCoxeter::prefill(std::shared_ptr<FroidurePinBase> const& S) {
       REPORT_DEBUG_DEFAULT("prefilling the coset table from FroidurePin...\n");
       LIBSEMIGROUPS_ASSERT(_state == state::constructed);
       LIBSEMIGROUPS_ASSERT(
           _settings->froidure_pin == options::froidure_pin::use_cayley_graph
           || _settings->froidure_pin == options::froidure_pin::none);
-      LIBSEMIGROUPS_ASSERT(S.number_of_generators() == number_of_generators());
-      if (kind() == congruence_kind::left) {
-        prefill_and_validate(S.left_cayley_graph(), false);
-      } else {
-        prefill_and_validate(S.right_cayley_graph(), false);
+      LIBSEMIGROUPS_ASSERT(S->number_of_generators()
+                           == number_of_generators());
+      LIBSEMIGROUPS_ASSERT(empty());
+      if (_settings->strategy == options::strategy::felsch) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "it is not possible to prefill when using the Felsch strategy");
       }
+      table_type const& graph = (kind() == congruence_kind::left
+                                     ? S->left_cayley_graph()
+                                     : S->right_cayley_graph());
+#ifdef LIBSEMIGROUPS_DEBUG
+      // This is a check of program logic, since we use parent() to fill
+      // the table, so we only validate in debug mode.
+      validate_table(graph, 0, graph.number_of_rows());
+#endif
+      // The rows of the Cayley graph of S are not copied into _table, but are
+      // read directly from S until they are modified. The aliasing shared_ptr
+      // keeps S alive for as long as any row is borrowed. Row 0 corresponds
+      // to the identity coset.
+      _prefilled = true;
+      _table     = detail::CopyOnWriteArray2<coset_type>(
+          std::shared_ptr<table_type const>(S, &graph), 1, UNDEFINED);
       for (size_t i = 0; i < number_of_generators(); i++) {
-        _table.set(0, i, S.current_position(i) + 1);
+        _table.set(0, i, S->current_position(i) + 1);
+      }
+      size_t const m = _table.number_of_rows();
+      add_active_cosets(m - number_of_cosets_active());
+      if (_settings->store_preimages) {
+        _preim_init.add_rows(m - _preim_init.number_of_rows());
+        _preim_next.add_rows(m - _preim_next.number_of_rows());
+        init_preimages_from_table();
+      } else {
+        _track_preimages = false;
       }
-      init_preimages_from_table();
     }
 
     void ToddCoxeter::prefill_and_validate(table_type const& table,
@@ -1063,12 +1207,40 @@ namespace libsemigroups {
         // Clear the new coset's row in each table
         for (letter_type i = 0; i < number_of_generators(); i++) {
           _table.set(c, i, UNDEFINED);
-          _preim_init.set(c, i, UNDEFINED);
+        }
+        if (_track_preimages) {
+          for (letter_type i = 0; i < number_of_generators(); i++) {
+            _preim_init.set(c, i, UNDEFINED);
+          }
         }
         return c;
       }
     }
 
+    // Reallocate the preimages, if necessary, and recompute them from the
+    // table, which must only contain active cosets.
+    void ToddCoxeter::rebuild_preimages() {
+      REPORT_DEBUG_DEFAULT("rebuilding preimages...\n");
+      size_t const n = number_of_generators();
+      _preim_init.add_rows(coset_capacity() - _preim_init.number_of_rows());
+      _preim_next.add_rows(coset_capacity() - _preim_next.number_of_rows());
+      for (coset_type c = _id_coset; c != first_free_coset();
+           c            = next_active_coset(c)) {
+        for (letter_type i = 0; i < n; ++i) {
+          _preim_init.set(c, i, UNDEFINED);
+        }
+      }
+      for (coset_type c = _id_coset; c != first_free_coset();
+           c            = next_active_coset(c)) {
+        for (letter_type i = 0; i < n; ++i) {
+          coset_type const v = _table.get(c, i);
+          if (v != UNDEFINED) {
+            add_preimage(v, i, c);
+          }
+        }
+      }
+    }
+
     void ToddCoxeter::remove_preimage(coset_type  cx,
                                       letter_type x,
                                       coset_type  d) {
@@ -1086,6 +1258,103 @@ namespace libsemigroups {
       }
     }
 
+    // Process all of the coincidences in _coinc (and those that they imply) at
+    // once. The first pass only identifies cosets in a union-find, merging the
+    // row of each representative into the row of the new representative, and
+    // does not touch the preimages. The second pass kills every non-minimum
+    // coset in each class, and the final pass rewrites every entry in the
+    // table, and rebuilds the preimages from scratch (if they are being
+    // stored).
+    template <typename TStackDeduct>
+    void ToddCoxeter::process_large_collapse() {
+      REPORT_DEFAULT("large collapse, processing %llu coincidences...\n",
+                     static_cast<uint64_t>(_coinc.size()));
+      detail::Timer tmr;
+      size_t const  n = number_of_generators();
+
+      // uf and min are only ever modified at the cosets in touched, and are
+      // reset at those cosets before returning.
+      detail::Duf<>&           uf  = _large_collapse_uf;
+      std::vector<coset_type>& min = _large_collapse_min;
+      uf.resize(coset_capacity());
+      min.resize(coset_capacity(), coset_type(UNDEFINED));
+      std::vector<coset_type> touched;
+      while (!_coinc.empty()) {
+        Coincidence c = _coinc.top();
+        _coinc.pop();
+        coset_type x = uf.find(find_coset(c.first));
+        coset_type y = uf.find(find_coset(c.second));
+        if (x != y) {
+          touched.push_back(x);
+          touched.push_back(y);
+          uf.unite(x, y);
+          coset_type const r = uf.find(x);
+          coset_type const s = (r == x ? y : x);
+          // Merge the row of s into that of r
+          for (letter_type i = 0; i < n; ++i) {
+            coset_type const v = _table.get(s, i);
+            if (v != UNDEFINED) {
+              coset_type const u = _table.get(r, i);
+              if (u == UNDEFINED) {
+                _table.set(r, i, v);
+              } else if (u != v) {
+                _coinc.emplace(u, v);
+              }
+            }
+          }
+        }
+      }
+
+      // Kill every coset in a class except the least one, which inherits the
+      // row of the representative in uf.
+      std::sort(touched.begin(), touched.end());
+      touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+      for (auto const c : touched) {
+        coset_type const r = uf.find(c);
+        if (min[r] == UNDEFINED) {
+          // touched is sorted, and so c is the least coset in its class
+          min[r] = c;
+          if (r != c) {
+            for (letter_type i = 0; i < n; ++i) {
+              _table.set(c, i, _table.get(r, i));
+              TStackDeduct()(_deduct, c, i);
+            }
+          }
+        } else {
+          union_cosets(min[r], c);
+        }
+      }
+      for (auto const c : touched) {
+        min[uf.find(c)] = UNDEFINED;
+      }
+      for (auto const c : touched) {
+        uf.reset(c);
+      }
+
+      // Rewrite the table and rebuild the preimages (if any)
+      for (coset_type c = _id_coset; c != first_free_coset();
+           c            = next_active_coset(c)) {
+        for (letter_type i = 0; i < n; ++i) {
+          coset_type const v = _table.get(c, i);
+          if (v != UNDEFINED) {
+            coset_type const w = find_coset(v);
+            if (w != v) {
+              _table.set(c, i, w);
+              TStackDeduct()(_deduct, c, i);
+            }
+          }
+        }
+      }
+      if (_track_preimages) {
+        rebuild_preimages();
+      }
+      TODD_COXETER_REPORT_COSETS()
+      REPORT_TIME(tmr);
+#ifdef LIBSEMIGROUPS_DEBUG
+      debug_validate_table();
+#endif
+    }
+
     // Perform a DFS in _felsch_tree
     void ToddCoxeter::make_deductions_dfs(coset_type c) {
       for (auto it = _felsch_tree->cbegin(); it < _felsch_tree->cend(); ++it) {
@@ -1234,6 +1503,11 @@ namespace libsemigroups {
       if (_settings->save) {
         init_felsch_tree();
       }
+      if (!_settings->store_preimages) {
+        _track_preimages = false;
+        _preim_init.shrink_rows_to(0);
+        _preim_next.shrink_rows_to(0);
+      }
       // size_t const n = number_of_generators();
       while (_current != first_free_coset() && !stopped()) {
         if (!_settings->save) {
@@ -1274,6 +1548,19 @@ namespace libsemigroups {
         }
         _current = next_active_coset(_current);
       }
+      if (!_track_preimages) {
+        // Every active coset has been pushed through the relations if
+        // _current == first_free_coset(), and processing the remaining
+        // coincidences does not change this, but it may change
+        // first_free_coset().
+        bool const done = (_current == first_free_coset());
+        if (!_coinc.empty()) {
+          process_large_collapse<DoNotStackDeductions>();
+        }
+        if (done) {
+          _current = first_free_coset();
+        }
+      }
       LIBSEMIGROUPS_ASSERT(_coinc.empty());
       LIBSEMIGROUPS_ASSERT(_deduct.empty());
       if (!stopped()) {
@@ -1347,6 +1634,124 @@ namespace libsemigroups {
       perform_lookahead();
     }
 
+    // Runs HLT or Felsch for intervals of length random_interval, and after
+    // each interval chooses the variant for the next one using:
+    //
+    // * p: the number of cosets killed divided by the number defined in the
+    //   interval;
+    // * f: the proportion of the entries in the rows of the active cosets
+    //   that are defined, estimated using a sample of rows;
+    // * whether the number of active cosets fell during the interval;
+    // * the size of the deduction stack.
+    //
+    // HLT is preferred while the table is not too sparse, since it defines
+    // cosets most quickly. If the table is sparse (f < 1/2) and few cosets are
+    // being killed (p < 1/8), then HLT is mostly defining cosets along the
+    // relations that do not close, and so we switch to Felsch. We switch back
+    // from Felsch to HLT when the table is almost full (f >= 9/10) but the
+    // number of active cosets is not falling. While HLT is killing many cosets
+    // (p >= 1/2) deductions are processed, full lookaheads are used, and the
+    // next lookahead is brought forward, otherwise there is no deduction
+    // processing and partial lookaheads are used. Nothing is changed while
+    // the deduction stack is non-empty.
+    void ToddCoxeter::adaptive() {
+      REPORT_DEFAULT("performing adaptive strategy...\n");
+      static const std::string line = std::string(79, '#') + '\n';
+#ifdef LIBSEMIGROUPS_DEBUG
+      // See the comment in sims.
+      _settings->enable_debug_verify_no_missing_deductions = false;
+#endif
+      init();
+      size_t const n = number_of_generators();
+      // The settings changed below are restored before returning
+      options::lookahead const old_lookahead      = _settings->lookahead;
+      size_t const             old_next_lookahead = _settings->next_lookahead;
+      bool const               old_save           = _settings->save;
+
+      auto fill = [this, &n]() -> double {
+        size_t const m       = coset_capacity();
+        size_t const step    = std::max(m / 4096, size_t(1));
+        size_t       defined = 0;
+        size_t       total   = 0;
+        for (coset_type c = 0; c < m; c += step) {
+          if (is_active_coset(c)) {
+            total += n;
+            for (letter_type x = 0; x < n; ++x) {
+              defined += (_table.get(c, x) != UNDEFINED);
+            }
+          }
+        }
+        return (total == 0 ? 1.0 : static_cast<double>(defined) / total);
+      };
+
+      auto try_save = [this](bool val) {
+        try {
+          save(val);
+        } catch (...) {
+          // See the comment in sims.
+        }
+      };
+
+      strategy(options::strategy::hlt);
+      lookahead(options::lookahead::partial);
+      try_save(false);
+
+      while (!finished() && !dead()) {
+        size_t const defined = number_of_cosets_defined();
+        size_t const killed  = number_of_cosets_killed();
+        size_t const active  = number_of_cosets_active();
+
+        REPORT(line).prefix().flush();
+        run_for(_settings->random_interval);
+        if (finished() || !_deduct.empty()) {
+          continue;
+        }
+
+        size_t const d       = number_of_cosets_defined() - defined;
+        size_t const k       = number_of_cosets_killed() - killed;
+        double const p       = (d == 0 ? 0.0 : static_cast<double>(k) / d);
+        double const f       = fill();
+        bool const   falling = number_of_cosets_active() < active;
+        REPORT_DEFAULT("%d defined, %d killed, %.2f%% of table filled\n",
+                       d,
+                       k,
+                       100 * f);
+
+        if (_settings->strategy == options::strategy::hlt) {
+          if (f < 0.5 && p < 0.125) {
+            try {
+              strategy(options::strategy::felsch);
+              continue;
+            } catch (...) {
+              // See the comment in sims.
+            }
+          }
+          if (p >= 0.5) {
+            try_save(true);
+            lookahead(options::lookahead::full);
+            size_t const m = number_of_cosets_active();
+            next_lookahead(std::min(_settings->next_lookahead, m + m / 2));
+          } else {
+            try_save(false);
+            lookahead(options::lookahead::partial);
+          }
+        } else if (f >= 0.9 && !falling) {
+          strategy(options::strategy::hlt);
+        }
+      }
+      _settings->strategy = options::strategy::adaptive;
+      LIBSEMIGROUPS_ASSERT(_coinc.empty());
+      LIBSEMIGROUPS_ASSERT(_deduct.empty());
+      if (!dead()) {
+        // See the comment at the end of sims.
+        lookahead(options::lookahead::full);
+        perform_lookahead();
+      }
+      _settings->lookahead      = old_lookahead;
+      _settings->next_lookahead = old_next_lookahead;
+      _settings->save           = old_save;
+    }
+
     // TODO(later) we could use deduction processing here instead of this,
     // where appropriate?
     void ToddCoxeter::perform_lookahead() {
@@ -1380,6 +1785,9 @@ namespace libsemigroups {
           TODD_COXETER_REPORT_COSETS()
         }
       }
+      if (!_track_preimages && !_coinc.empty()) {
+        process_large_collapse<DoNotStackDeductions>();
+      }
       number_of_killed = number_of_cosets_killed() - number_of_killed;
       if (number_of_cosets_active() > _settings->next_lookahead
           || number_of_killed < (number_of_cosets_active() / 4)) {
@@ -1483,6 +1891,11 @@ namespace libsemigroups {
     }
 
     void ToddCoxeter::shortlex_standardize() {
+      size_t const N = number_of_threads();
+      if (N > 1) {
+        shortlex_standardize_concurrently(N);
+        return;
+      }
       REPORT_DEFAULT("standardizing (shortlex)... ");
       detail::Timer           tmr;
       coset_type              t = 0;
@@ -1506,6 +1919,95 @@ namespace libsemigroups {
 #endif
     }
 
+    // Breadth-first search through _table one level at a time. The edges
+    // leaving the cosets in the current level whose targets are not yet
+    // numbered are found concurrently, and then the targets are numbered in
+    // the same order as in shortlex_standardize.
+    void ToddCoxeter::shortlex_standardize_concurrently(size_t const N) {
+      REPORT_DEFAULT("standardizing (shortlex, %d threads)... ", N);
+      detail::Timer tmr;
+      size_t const  n = number_of_generators();
+
+      struct Edge {
+        coset_type  source;  // new
+        letter_type gen;
+        coset_type  target;  // old
+      };
+
+      // p : new -> old and q : old -> new
+      std::vector<coset_type> p;
+      p.reserve(coset_capacity());
+      p.push_back(_id_coset);
+      std::vector<coset_type> q(coset_capacity(), coset_type(UNDEFINED));
+      q[_id_coset] = 0;
+
+      std::vector<std::vector<Edge>> edges(N);
+      auto func = [this, &edges, &p, &q, &n](
+                      size_t i, size_t first, size_t last) {
+        edges[i].clear();
+        for (coset_type s = first; s < last; ++s) {
+          for (letter_type x = 0; x < n; ++x) {
+            coset_type const r = _table.get(p[s], x);
+            if (r != UNDEFINED && q[r] == UNDEFINED) {
+              edges[i].push_back({s, x, r});
+            }
+          }
+        }
+      };
+
+      size_t first = 0;
+      while (first < p.size()) {
+        size_t const last = p.size();
+        if (last - first < N) {
+          func(0, first, last);
+          for (size_t i = 1; i < N; ++i) {
+            edges[i].clear();
+          }
+        } else {
+          std::vector<std::thread> threads;
+          for (size_t i = 0; i < N; ++i) {
+            threads.emplace_back(func,
+                                 i,
+                                 first + (i * (last - first)) / N,
+                                 first + ((i + 1) * (last - first)) / N);
+          }
+          for (auto& t : threads) {
+            t.join();
+          }
+        }
+        for (auto const& v : edges) {
+          for (auto const& e : v) {
+            if (q[e.target] == UNDEFINED) {
+              q[e.target]        = p.size();
+              (*_tree)[p.size()] = TreeNode(e.source, e.gen);
+              p.push_back(e.target);
+            }
+          }
+        }
+        first = last;
+      }
+      // The active cosets must come before the free cosets.
+      for (coset_type c = _id_coset; c != first_free_coset();
+           c            = next_active_coset(c)) {
+        if (q[c] == UNDEFINED) {
+          q[c] = p.size();
+          p.push_back(c);
+        }
+      }
+      for (coset_type c = 0; c < q.size(); ++c) {
+        if (q[c] == UNDEFINED) {
+          q[c] = p.size();
+          p.push_back(c);
+        }
+      }
+      apply_permutation(p, q);
+      REPORT("%s\n", tmr.string().c_str()).prefix().flush_right().flush();
+#ifdef LIBSEMIGROUPS_DEBUG
+      debug_validate_forwd_bckwd();
+      debug_validate_table();
+#endif
+    }
+
     // This is how the recursive words up to a given length M, and on an
     // arbitrary finite alphabet are generated.  On a single letter alphabet,
     // this order is just increasing powers of the only generator:
@@ -1648,26 +2150,40 @@ namespace libsemigroups {
         LIBSEMIGROUPS_ASSERT(q[p[c]] == c);
       }
 #endif
-      {
-        coset_type   c = _id_coset;
-        size_t const n = number_of_generators();
-        // Permute all the values in the _table, and pre-images, that relate
-        // to active cosets
-        while (c < number_of_cosets_active()) {
-          for (letter_type x = 0; x < n; ++x) {
-            coset_type i = _table.get(p[c], x);
-            _table.set(p[c], x, (i == UNDEFINED ? i : q[i]));
-            i = _preim_init.get(p[c], x);
-            _preim_init.set(p[c], x, (i == UNDEFINED ? i : q[i]));
-            i = _preim_next.get(p[c], x);
-            _preim_next.set(p[c], x, (i == UNDEFINED ? i : q[i]));
+      size_t const N = number_of_threads();
+      if (N > 1 && !_table.has_shared_rows()) {
+        // Permute the tables in place, using N threads
+        permute_table(_table.array(), p, q, number_of_cosets_active(), N);
+        if (_track_preimages) {
+          permute_table(_preim_init, p, q, number_of_cosets_active(), N);
+          permute_table(_preim_next, p, q, number_of_cosets_active(), N);
+        }
+      } else {
+        // Permute all the values in the _table. Any rows borrowed from the
+        // Cayley graph of parent_froidure_pin() are relabelled when they are
+        // read, and so they are not copied.
+        _table.apply_value_permutation(q);
+        if (_track_preimages) {
+          coset_type   c = _id_coset;
+          size_t const n = number_of_generators();
+          // Permute all the values in the pre-images that relate to active
+          // cosets
+          while (c < number_of_cosets_active()) {
+            for (letter_type x = 0; x < n; ++x) {
+              coset_type i = _preim_init.get(p[c], x);
+              _preim_init.set(p[c], x, (i == UNDEFINED ? i : q[i]));
+              i = _preim_next.get(p[c], x);
+              _preim_next.set(p[c], x, (i == UNDEFINED ? i : q[i]));
+            }
+            c++;
           }
-          c++;
         }
         // Permute the rows themselves
         _table.apply_row_permutation(p);
-        _preim_init.apply_row_permutation(p);
-        _preim_next.apply_row_permutation(p);
+        if (_track_preimages) {
+          _preim_init.apply_row_permutation(p);
+          _preim_next.apply_row_permutation(p);
+        }
       }
       {
         // Permute the cosets in the CosetManager using p . . .
@@ -1685,12 +2201,21 @@ namespace libsemigroups {
       }
     }
 
+    size_t ToddCoxeter::number_of_threads() const noexcept {
+      if (number_of_cosets_active() < _settings->concurrency_threshold
+          || _settings->max_threads == 1) {
+        return 1;
+      }
+      return _settings->max_threads;
+    }
+
     // Based on the procedure SWITCH in Sims' book, p193
     // Swaps an active coset and another coset in the table.
     void ToddCoxeter::swap(coset_type c, coset_type d) {
       TODD_COXETER_REPORT_SWITCH(c, d)
 
       LIBSEMIGROUPS_ASSERT(_coinc.empty());
+      LIBSEMIGROUPS_ASSERT(_track_preimages);
       LIBSEMIGROUPS_ASSERT(c != _id_coset);
       LIBSEMIGROUPS_ASSERT(d != _id_coset);
       LIBSEMIGROUPS_ASSERT(c != d);
@@ -1823,6 +2348,9 @@ namespace libsemigroups {
 
     // Validates the preimages, this is very expensive.
     void ToddCoxeter::debug_validate_preimages() const {
+      if (!_track_preimages) {
+        return;
+      }
       REPORT_DEBUG_DEFAULT("validating preimages... ");
       size_t const n = number_of_generators();
       coset_type   c = _id_coset;
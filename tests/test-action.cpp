@@ -19,8 +19,9 @@
 // 1. add examples from Action
 
 #include <algorithm>  // for sort
+#include <atomic>     // for atomic
 #include <cstdint>    // for uint8_t
-#include <stdexcept>  // for out_of_range
+#include <stdexcept>  // for out_of_range, runtime_error
 #include <vector>     // for vector
 
 #include "libsemigroups/action.hpp"  // for LeftAction, RightAction
@@ -696,4 +697,155 @@ namespace libsemigroups {
       "[standard][no-valgrind]") {
     test000<BMat<5>>();
   }
+
+  namespace {
+    template <typename PPermType>
+    void test001() {
+      auto rg = ReportGuard(REPORT);
+      using action_type
+          = RightAction<PPermType,
+                        PPermType,
+                        ImageRightAction<PPermType, PPermType>>;
+      std::vector<PPermType> gens
+          = {PPermType::make(
+                 {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+                 {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0},
+                 16),
+             PPermType::make(
+                 {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+                 {1, 0, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+                 16),
+             PPermType::make(
+                 {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+                 {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14},
+                 16),
+             PPermType::make(
+                 {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14},
+                 {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+                 16)};
+
+      action_type o1;
+      o1.add_seed(PPermType::identity(16));
+      for (auto const& x : gens) {
+        o1.add_generator(x);
+      }
+      REQUIRE(o1.max_threads() == 1);
+      REQUIRE(o1.size() == 65536);
+
+      action_type o2;
+      REQUIRE(o2.max_threads(0).max_threads() == 1);
+      o2.max_threads(4);
+      REQUIRE(o2.max_threads() == 4);
+      o2.add_seed(PPermType::identity(16));
+      // Add the last generator after starting, so that the points found so
+      // far are acted on by it first.
+      for (auto it = gens.cbegin(); it < gens.cend() - 1; ++it) {
+        o2.add_generator(*it);
+      }
+      o2.run_until([&o2]() { return o2.current_size() > 20000; });
+      o2.add_generator(gens.back());
+      REQUIRE(o2.size() == 65536);
+
+      action_type o3;
+      o3.max_threads(4);
+      o3.add_seed(PPermType::identity(16));
+      for (auto const& x : gens) {
+        o3.add_generator(x);
+      }
+      o3.run_until([&o3]() { return o3.current_size() > 40000; });
+      REQUIRE(!o3.finished());
+      REQUIRE(o3.size() == 65536);
+      REQUIRE(std::equal(o1.cbegin(), o1.cend(), o3.cbegin()));
+      REQUIRE(o3.digraph().number_of_scc() == 17);
+      for (size_t i = 0; i < o1.size(); ++i) {
+        REQUIRE(o3.position(o1[i]) == i);
+        for (size_t j = 0; j < gens.size(); ++j) {
+          REQUIRE(o1.digraph().neighbor(i, j) == o3.digraph().neighbor(i, j));
+        }
+      }
+      REQUIRE(o2.digraph().number_of_scc() == 17);
+      for (auto it = o1.cbegin(); it < o1.cend(); ++it) {
+        REQUIRE(o2.position(*it) != UNDEFINED);
+      }
+    }
+  }  // namespace
+
+  LIBSEMIGROUPS_TEST_CASE("Action",
+                          "022",
+                          "partial perm image orbit using 4 threads (PPerm<16>)",
+                          "[quick][no-valgrind]") {
+    test001<PPerm<16>>();
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Action",
+                          "023",
+                          "partial perm image orbit using 4 threads (PPerm<>)",
+                          "[quick][no-valgrind]") {
+    test001<PPerm<>>();
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Action",
+                          "024",
+                          "row space orbit (StaticVector1) with reserve",
+                          "[quick]") {
+    auto rg        = ReportGuard(REPORT);
+    using Mat      = BMat<4>;
+    using row_type = detail::StaticVector1<BitSet<4>, 4>;
+    RightAction<Mat, row_type, ImageRightAction<Mat, row_type>> o;
+    o.reserve(1);
+    o.add_seed(
+        {BitSet<4>(0x8), BitSet<4>(0x4), BitSet<4>(0x2), BitSet<4>(0x1)});
+    o.add_generator(
+        Mat({{0, 1, 0, 0}, {1, 0, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}));
+    o.add_generator(
+        Mat({{0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}, {1, 0, 0, 0}}));
+    o.add_generator(
+        Mat({{1, 0, 0, 0}, {1, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}));
+    o.add_generator(
+        Mat({{0, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}));
+    REQUIRE(o.size() == 1257);
+    size_t i = 0;
+    for (auto it = o.cbegin(); it < o.cend(); ++it, ++i) {
+      REQUIRE(o.position(*it) == i);
+      REQUIRE(*it == o[i]);
+    }
+    REQUIRE(o.position({BitSet<4>(0x1), BitSet<4>(0x1)}) == UNDEFINED);
+  }
+
+  namespace {
+    // Throws the first time that it is called when number_of_calls is 100.
+    std::atomic<size_t> number_of_calls(0);
+
+    struct ThrowingImageRightAction {
+      void operator()(PPerm<>& res, PPerm<> const& pt, PPerm<> const& x) {
+        if (++number_of_calls == 100) {
+          throw std::runtime_error("oops");
+        }
+        ImageRightAction<PPerm<>, PPerm<>>()(res, pt, x);
+      }
+    };
+  }  // namespace
+
+  LIBSEMIGROUPS_TEST_CASE("Action",
+                          "025",
+                          "exception thrown by a thread is rethrown by run",
+                          "[quick]") {
+    auto rg = ReportGuard(REPORT);
+    RightAction<PPerm<>, PPerm<>, ThrowingImageRightAction> o;
+    o.max_threads(4);
+    o.add_seed(PPerm<>::identity(8));
+    o.add_generator(
+        PPerm<>::make({0, 1, 2, 3, 4, 5, 6, 7}, {1, 2, 3, 4, 5, 6, 7, 0}, 8));
+    o.add_generator(
+        PPerm<>::make({0, 1, 2, 3, 4, 5, 6, 7}, {1, 0, 2, 3, 4, 5, 6, 7}, 8));
+    o.add_generator(
+        PPerm<>::make({1, 2, 3, 4, 5, 6, 7}, {0, 1, 2, 3, 4, 5, 6}, 8));
+    o.add_generator(
+        PPerm<>::make({0, 1, 2, 3, 4, 5, 6}, {1, 2, 3, 4, 5, 6, 7}, 8));
+    REQUIRE_THROWS_AS(o.run(), std::runtime_error);
+    REQUIRE(!o.finished());
+    // The block in which the exception was thrown is run again.
+    REQUIRE(o.size() == 256);
+    REQUIRE(o.digraph().number_of_scc() == 9);
+  }
 }  // namespace libsemigroups
@@ -16,6 +16,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <memory>   // for make_shared
 #include <numeric>  // for iota
 
 #include "catch.hpp"
@@ -1462,9 +1463,10 @@ namespace libsemigroups {
         std::fill(rv.begin_row(i), rv.end_row(i), i);
       }
       std::vector<size_t> p = {1, 2, 3, 4, 5, 6, 7, 0, 9, 8};
-      // copy p, since the apply_row_permutation method modifies p.
+      // apply_row_permutation does not modify p
       std::vector<size_t> q = p;
       rv.apply_row_permutation(p);
+      REQUIRE(p == q);
 
       for (size_t i = 0; i < 10; i++) {
         REQUIRE(std::all_of(rv.begin_row(i), rv.end_row(i), [&q, &i](size_t x) {
@@ -1601,6 +1603,126 @@ namespace libsemigroups {
       REQUIRE(std::vector<size_t>(rry.begin(2), rry.end(2))
               == std::vector<size_t>({11, 11, 11}));
     }
+
+    LIBSEMIGROUPS_TEST_CASE("CopyOnWriteArray2",
+                            "044",
+                            "all",
+                            "[containers][quick]") {
+      auto shared = std::make_shared<DynamicArray2<size_t>>(
+          DynamicArray2<size_t>({{0, 1}, {2, 0}, {1, 1}}));
+      CopyOnWriteArray2<size_t> cow(shared, 1, 10);
+      REQUIRE(cow.has_shared_rows());
+      REQUIRE(cow.number_of_rows() == 4);
+      REQUIRE(cow.number_of_cols() == 2);
+      REQUIRE(cow.get(0, 0) == 10);
+      REQUIRE(cow.get(1, 1) == 2);
+      REQUIRE(cow.get(2, 0) == 3);
+      REQUIRE(cow.get(3, 1) == 2);
+
+      cow.set(0, 0, 1);
+      cow.set(2, 1, 0);
+      REQUIRE(cow.get(0, 0) == 1);
+      REQUIRE(cow.get(2, 0) == 3);
+      REQUIRE(cow.get(2, 1) == 0);
+      // The shared array is never modified
+      REQUIRE(*shared == DynamicArray2<size_t>({{0, 1}, {2, 0}, {1, 1}}));
+
+      cow.swap(1, 0, 2, 1);
+      REQUIRE(cow.get(1, 0) == 0);
+      REQUIRE(cow.get(2, 1) == 1);
+
+      cow.add_rows(1);
+      REQUIRE(cow.number_of_rows() == 5);
+      REQUIRE(cow.get(4, 0) == 10);
+      REQUIRE(cow.get(4, 1) == 10);
+
+      cow.apply_row_permutation({0, 3, 2, 1, 4});
+      REQUIRE(cow.get(1, 0) == 2);
+      REQUIRE(cow.get(1, 1) == 2);
+      REQUIRE(cow.get(3, 0) == 0);
+      REQUIRE(cow.get(3, 1) == 2);
+      REQUIRE(cow.has_shared_rows());
+
+      CopyOnWriteArray2<size_t> copy(cow);
+      copy.shrink_rows_to(2);
+      REQUIRE(copy.number_of_rows() == 2);
+      REQUIRE(copy.has_shared_rows());
+      copy.set(1, 0, 0);
+      REQUIRE(copy.get(1, 1) == 2);
+      copy.shrink_rows_to(2);
+      REQUIRE(copy.has_shared_rows());
+      copy.shrink_rows_to(1);
+      REQUIRE(!copy.has_shared_rows());
+      REQUIRE(copy.array() == DynamicArray2<size_t>({{1, 10}}));
+      copy.add_rows(1);
+      REQUIRE(copy.array() == DynamicArray2<size_t>({{1, 10}, {10, 10}}));
+
+      // The shared array is kept alive by cow and its copies
+      CopyOnWriteArray2<size_t> other(cow);
+      REQUIRE(!cow.shared_array_modified());
+      shared->add_rows(1);
+      REQUIRE(cow.shared_array_modified());
+      REQUIRE(other.shared_array_modified());
+      shared.reset();
+      REQUIRE(cow.get(3, 0) == 0);
+      REQUIRE(other.get(1, 1) == 2);
+
+      cow.unshare();
+      REQUIRE(!cow.has_shared_rows());
+      REQUIRE(!cow.shared_array_modified());
+      REQUIRE(cow.array()
+              == DynamicArray2<size_t>(
+                  {{1, 10}, {2, 2}, {3, 1}, {0, 2}, {10, 10}}));
+      REQUIRE(other.has_shared_rows());
+      other.unshare();
+      REQUIRE(other.array() == cow.array());
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("CopyOnWriteArray2",
+                            "045",
+                            "apply_value_permutation",
+                            "[containers][quick]") {
+      auto shared = std::make_shared<DynamicArray2<size_t>>(
+          DynamicArray2<size_t>({{0, 1}, {2, 0}, {1, 1}}));
+      CopyOnWriteArray2<size_t> cow(shared, 1, 10);
+      cow.set(0, 0, 1);
+      REQUIRE(cow.number_of_shared_rows() == 3);
+
+      std::vector<size_t> const q = {0, 2, 3, 1};
+      cow.apply_value_permutation(q);
+      REQUIRE(cow.number_of_shared_rows() == 3);
+      REQUIRE(cow.get(0, 0) == 2);
+      REQUIRE(cow.get(0, 1) == 10);
+      REQUIRE(cow.get(1, 0) == 2);
+      REQUIRE(cow.get(1, 1) == 3);
+      REQUIRE(cow.get(2, 0) == 1);
+      REQUIRE(cow.get(2, 1) == 2);
+      REQUIRE(cow.get(3, 0) == 3);
+      REQUIRE(cow.get(3, 1) == 3);
+      REQUIRE(*shared == DynamicArray2<size_t>({{0, 1}, {2, 0}, {1, 1}}));
+
+      cow.apply_value_permutation(q);
+      REQUIRE(cow.number_of_shared_rows() == 3);
+      REQUIRE(cow.get(0, 0) == 3);
+      REQUIRE(cow.get(1, 0) == 3);
+      REQUIRE(cow.get(1, 1) == 1);
+
+      cow.set(2, 0, 0);
+      REQUIRE(cow.number_of_shared_rows() == 2);
+      REQUIRE(cow.get(2, 0) == 0);
+      REQUIRE(cow.get(2, 1) == 3);
+
+      cow.apply_value_permutation({0, 1, 2, 3});
+      REQUIRE(cow.number_of_shared_rows() == 2);
+
+      cow.unshare();
+      REQUIRE(cow.number_of_shared_rows() == 0);
+      REQUIRE(cow.array()
+              == DynamicArray2<size_t>({{3, 10}, {3, 1}, {0, 3}, {1, 1}}));
+      cow.apply_value_permutation(q);
+      REQUIRE(cow.array()
+              == DynamicArray2<size_t>({{1, 10}, {1, 2}, {0, 1}, {2, 2}}));
+    }
   }  // namespace detail
 
 }  // namespace libsemigroups
@@ -37,7 +37,10 @@
 
 // #define CATCH_CONFIG_ENABLE_PAIR_STRINGMAKER
 
-#include <vector>  // for vector
+#include <algorithm>  // for equal
+#include <sstream>    // for stringstream
+#include <thread>     // for thread
+#include <vector>     // for vector
 
 #include "catch.hpp"      // for REQUIRE, REQUIRE_NOTHROW, REQUIRE_THROWS_AS
 #include "test-main.hpp"  // for LIBSEMIGROUPS_TEST_CASE
@@ -46,6 +49,7 @@
 #include "libsemigroups/kbe.hpp"           // for detail::KBE
 #include "libsemigroups/knuth-bendix.hpp"  // for KnuthBendix, operator<<
 #include "libsemigroups/report.hpp"        // for ReportGuard
+#include "libsemigroups/siso.hpp"          // for cbegin_sislo, cend_sislo
 #include "libsemigroups/transf.hpp"        // for Transf<>
 #include "libsemigroups/types.hpp"         // for word_type
 
@@ -158,5 +162,485 @@ namespace libsemigroups {
       REQUIRE(kb.knuth_bendix().confluent());
       REQUIRE(kb.number_of_classes() == 88);
     }
+
+    LIBSEMIGROUPS_TEST_CASE("KnuthBendix",
+                            "117",
+                            "(fpsemi) parallel overlaps",
+                            "[quick][knuth-bendix][fpsemigroup][fpsemi]") {
+      auto        rg = ReportGuard(REPORT);
+      KnuthBendix kb1;
+      kb1.set_alphabet("abcd");
+      kb1.set_identity("d");
+      kb1.add_rule("aa", "d");
+      kb1.add_rule("bb", "d");
+      kb1.add_rule("cc", "d");
+      kb1.add_rule("ababab", "d");
+      kb1.add_rule("bcbcbcbc", "d");
+      kb1.add_rule("acac", "d");
+
+      KnuthBendix kb2(kb1);
+      kb2.max_threads(4).check_confluence_interval(10);
+      kb2.run();
+      REQUIRE(kb2.confluent());
+
+      kb1.run();
+      REQUIRE(kb1.confluent());
+      REQUIRE(kb1.number_of_active_rules() == kb2.number_of_active_rules());
+      REQUIRE(kb2.size() == 48);
+      REQUIRE(std::equal(kb1.cbegin_normal_forms(0, 10),
+                         kb1.cend_normal_forms(),
+                         kb2.cbegin_normal_forms(0, 10)));
+
+      KnuthBendix kb3;
+      kb3.set_alphabet("ab");
+      kb3.add_rule("aaa", "a");
+      kb3.add_rule("bbbb", "b");
+      kb3.add_rule("abababab", "aa");
+      kb3.max_threads(0);
+      kb3.run();
+
+      KnuthBendix kb4(kb3);
+      kb4.max_threads(3);
+      kb4.run();
+      REQUIRE(kb4.confluent());
+      REQUIRE(kb3.size() == kb4.size());
+      REQUIRE(kb4.equal_to("abababab", "aa"));
+      REQUIRE(!kb4.equal_to("ab", "ba"));
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("KnuthBendix",
+                            "118",
+                            "(fpsemi) incremental confluence check",
+                            "[quick][knuth-bendix][fpsemigroup][fpsemi]") {
+      auto        rg = ReportGuard(REPORT);
+      KnuthBendix kb1;
+      kb1.set_alphabet("abc");
+      kb1.add_rule("aa", "");
+      kb1.add_rule("bb", "");
+      kb1.add_rule("cc", "");
+      kb1.add_rule("abab", "baba");
+      kb1.add_rule("bcbcbc", "cbcbcb");
+      kb1.add_rule("acac", "caca");
+
+      KnuthBendix kb2;
+      kb2.set_alphabet("abc");
+      for (auto const& rule : kb1.active_rules()) {
+        kb2.add_rule(rule.first, rule.second);
+        bool const result = kb2.confluent();
+        // Checked twice, since the second check only considers new rules
+        REQUIRE(kb2.confluent() == result);
+        REQUIRE(KnuthBendix(kb2).confluent() == result);
+      }
+      kb1.run();
+      for (auto const& rule : kb1.active_rules()) {
+        kb2.add_rule(rule.first, rule.second);
+        REQUIRE(kb2.confluent() == KnuthBendix(kb2).confluent());
+      }
+      REQUIRE(kb2.confluent());
+      REQUIRE(kb2.active_rules() == kb1.active_rules());
+
+      // confluent() is const, and so can be called from several threads
+      KnuthBendix kb3;
+      kb3.set_alphabet("abc");
+      auto const rules = kb1.active_rules();
+      for (auto it = rules.cbegin(); it < rules.cend() - 1; ++it) {
+        kb3.add_rule(it->first, it->second);
+      }
+      bool const               expected = KnuthBendix(kb3).confluent();
+      std::vector<int>         results(4, -1);
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back(
+            [&kb3, &results, i]() { results[i] = kb3.confluent(); });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      for (int result : results) {
+        REQUIRE(result == expected);
+      }
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("KnuthBendix",
+                            "119",
+                            "(fpsemi) save and load",
+                            "[quick][knuth-bendix][fpsemigroup][fpsemi]") {
+      auto        rg = ReportGuard(REPORT);
+      KnuthBendix kb1;
+      kb1.set_alphabet("aAbBe");
+      kb1.set_identity("e");
+      kb1.set_inverses("AaBbe");
+      kb1.add_rule("aaaa", "e");
+      kb1.add_rule("bbb", "e");
+      kb1.add_rule("abab", "e");
+      kb1.overlap_policy(KnuthBendix::options::overlap::AB_BC);
+      kb1.max_rules(12);
+      kb1.run();
+      REQUIRE(!kb1.confluent());
+
+      std::stringstream ss;
+      kb1.save(ss);
+      KnuthBendix kb2;
+      kb2.load(ss);
+      REQUIRE(kb2.alphabet() == kb1.alphabet());
+      REQUIRE(kb2.identity() == "e");
+      REQUIRE(kb2.inverses() == "AaBbe");
+      REQUIRE(kb2.number_of_rules() == kb1.number_of_rules());
+      REQUIRE(kb2.active_rules() == kb1.active_rules());
+      REQUIRE(!kb2.confluent());
+
+      // Resuming from the saved state gives the same rules as continuing
+      kb1.max_rules(POSITIVE_INFINITY);
+      kb1.run();
+      kb2.max_rules(POSITIVE_INFINITY);
+      kb2.run();
+      REQUIRE(kb2.confluent());
+      REQUIRE(kb2.active_rules() == kb1.active_rules());
+      REQUIRE(kb2.size() == 24);
+      REQUIRE(kb2.equal_to("ab", "BA"));
+
+      std::stringstream ss2;
+      kb2.save(ss2);
+      KnuthBendix kb3;
+      kb3.load(ss2);
+      REQUIRE(kb3.confluent());
+      REQUIRE(kb3.active_rules() == kb1.active_rules());
+      REQUIRE(kb3.size() == 24);
+
+      ss2.seekg(0);
+      REQUIRE_THROWS_AS(kb3.load(ss2), LibsemigroupsException);
+      KnuthBendix       kb4;
+      std::stringstream ss3("not a KnuthBendix instance");
+      REQUIRE_THROWS_AS(kb4.load(ss3), LibsemigroupsException);
+      std::string       str = ss.str();
+      std::stringstream ss4(str.substr(0, str.size() / 2));
+      KnuthBendix       kb5;
+      REQUIRE_THROWS_AS(kb5.load(ss4), LibsemigroupsException);
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("KnuthBendix",
+                            "120",
+                            "(fpsemi) batch normal_forms and equal_to",
+                            "[quick][knuth-bendix][fpsemigroup][fpsemi]") {
+      auto rg = ReportGuard(REPORT);
+      for (std::string lphbt : {"ab", "xy"}) {
+        KnuthBendix kb;
+        kb.set_alphabet(lphbt);
+        kb.add_rule(std::string(3, lphbt[0]), std::string(1, lphbt[0]));
+        kb.add_rule(std::string(4, lphbt[1]), std::string(1, lphbt[1]));
+        kb.add_rule(std::string(4, lphbt[0]) + lphbt[1] + lphbt[0],
+                    std::string(2, lphbt[0]));
+        kb.max_threads(4);
+
+        std::string         words;
+        std::vector<size_t> ends;
+        std::string const   last(10, lphbt[0]);
+        for (auto it = cbegin_sislo(lphbt, "", last);
+             it != cend_sislo(lphbt, "", last);
+             ++it) {
+          words += *it;
+          ends.push_back(words.size());
+        }
+        // Words of length at most 9
+        REQUIRE(ends.size() == 1023);
+        ends.pop_back();
+        words.resize(ends.back());
+
+        std::string         result;
+        std::vector<size_t> result_ends = {42};
+        kb.normal_forms(words, ends, result, result_ends);
+        REQUIRE(result_ends.size() == ends.size());
+        std::vector<bool> equal;
+        kb.equal_to(words, ends, equal);
+        REQUIRE(equal.size() == ends.size() / 2);
+
+        size_t prev = 0, result_prev = 0;
+        for (size_t i = 0; i < ends.size(); ++i) {
+          std::string const w = words.substr(prev, ends[i] - prev);
+          REQUIRE(result.substr(result_prev, result_ends[i] - result_prev)
+                  == kb.normal_form(w));
+          prev        = ends[i];
+          result_prev = result_ends[i];
+        }
+        for (size_t i = 0; i < equal.size(); ++i) {
+          size_t const first = (i == 0 ? 0 : ends[2 * i - 1]);
+          std::string  u = words.substr(first, ends[2 * i] - first);
+          std::string  v
+              = words.substr(ends[2 * i], ends[2 * i + 1] - ends[2 * i]);
+          REQUIRE(equal[i] == kb.equal_to(u, v));
+        }
+
+        // Every word paired with its normal form
+        std::string         pairs;
+        std::vector<size_t> pairs_ends;
+        prev = 0, result_prev = 0;
+        for (size_t i = 0; i < ends.size(); ++i) {
+          pairs.append(words, prev, ends[i] - prev);
+          pairs_ends.push_back(pairs.size());
+          pairs.append(result, result_prev, result_ends[i] - result_prev);
+          pairs_ends.push_back(pairs.size());
+          prev        = ends[i];
+          result_prev = result_ends[i];
+        }
+        kb.equal_to(pairs, pairs_ends, equal);
+        REQUIRE(equal == std::vector<bool>(ends.size(), true));
+
+        ends.back()--;
+        REQUIRE_THROWS_AS(kb.normal_forms(words, ends, result, result_ends),
+                          LibsemigroupsException);
+        ends.pop_back();
+        REQUIRE_THROWS_AS(kb.equal_to(words, ends, equal),
+                          LibsemigroupsException);
+        REQUIRE_THROWS_AS(kb.normal_forms("abc", {3}, result, result_ends),
+                          LibsemigroupsException);
+      }
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("KnuthBendix",
+                            "121",
+                            "(fpsemi) weighted and recursive path orderings",
+                            "[quick][knuth-bendix][fpsemigroup][fpsemi]") {
+      auto rg = ReportGuard(REPORT);
+      using order = KnuthBendix::options::order;
+      {
+        // Baumslag-Solitar group BS(1, 2), which does not have a finite
+        // complete rewriting system with respect to the short-lex ordering
+        KnuthBendix kb;
+        kb.set_alphabet("eaAbB");
+        kb.set_identity("e");
+        kb.set_inverses("eAaBb");
+        kb.add_rule("Bab", "aa");
+        kb.order(order::recursive);
+        kb.run();
+        REQUIRE(kb.confluent());
+        REQUIRE(kb.number_of_active_rules() == 17);
+        REQUIRE(kb.size() == POSITIVE_INFINITY);
+        REQUIRE(kb.equal_to("Baab", "aaaa"));
+        REQUIRE(kb.equal_to("Bab", "aa"));
+        REQUIRE(kb.normal_form("ab") == "baa");
+        REQUIRE(!kb.equal_to("ab", "ba"));
+        REQUIRE_THROWS_AS(kb.order(order::shortlex), LibsemigroupsException);
+      }
+      {
+        KnuthBendix kb;
+        kb.set_alphabet("ab");
+        kb.add_rule("aaa", "a");
+        kb.add_rule("b", "aa");
+        REQUIRE_THROWS_AS(kb.weights({1}), LibsemigroupsException);
+        REQUIRE_THROWS_AS(kb.weights({1, 0}), LibsemigroupsException);
+        kb.order(order::weighted_shortlex).weights({1, 3});
+        REQUIRE(kb.active_rules()
+                == std::vector<std::pair<std::string, std::string>>(
+                    {{"b", "aa"}, {"aaa", "a"}}));
+        REQUIRE(kb.size() == 2);
+        REQUIRE(kb.normal_form("bb") == "aa");
+        REQUIRE(kb.normal_form("ab") == "a");
+        REQUIRE(std::vector<std::string>(kb.cbegin_normal_forms(0, 10),
+                                         kb.cend_normal_forms())
+                == std::vector<std::string>({"a", "aa"}));
+        REQUIRE_THROWS_AS(kb.weights({1, 1}), LibsemigroupsException);
+      }
+      for (auto o :
+           {order::shortlex, order::weighted_shortlex, order::recursive}) {
+        KnuthBendix kb;
+        kb.set_alphabet("aAbBe");
+        kb.set_identity("e");
+        kb.set_inverses("AaBbe");
+        kb.add_rule("aaaa", "e");
+        kb.add_rule("bbb", "e");
+        kb.add_rule("abab", "e");
+        kb.order(o);
+        if (o == order::weighted_shortlex) {
+          kb.weights({2, 2, 3, 3, 1});
+        }
+        REQUIRE(kb.size() == 24);
+        REQUIRE(kb.equal_to("ab", "BA"));
+        REQUIRE(KnuthBendix(kb).size() == 24);
+      }
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("KnuthBendix",
+                            "122",
+                            "(fpsemi) froidure_pin_from_gilman_digraph",
+                            "[quick][knuth-bendix][fpsemigroup][fpsemi]") {
+      auto rg = ReportGuard(REPORT);
+      using order = KnuthBendix::options::order;
+      for (auto o :
+           {order::shortlex, order::weighted_shortlex, order::recursive}) {
+        KnuthBendix kb;
+        kb.set_alphabet("aAbBce");
+        kb.set_identity("e");
+        kb.set_inverses("AaBbce");
+        kb.add_rule("aaaa", "e");
+        kb.add_rule("bbb", "e");
+        kb.add_rule("abab", "e");
+        kb.add_rule("c", "a");
+        kb.order(o);
+        if (o == order::weighted_shortlex) {
+          kb.weights({2, 2, 3, 3, 2, 1});
+        }
+        auto S = kb.froidure_pin_from_gilman_digraph();
+        REQUIRE(S->finished());
+        // c = a is its own inverse, so this is the symmetric group of degree 3
+        REQUIRE(S->size() == 6);
+        REQUIRE(kb.size() == 6);
+        REQUIRE(S->number_of_generators() == 6);
+        auto T = kb.froidure_pin();
+        // With the recursive path ordering the normal form of B is aba, and so
+        // froidure_pin is used.
+        REQUIRE((S == T) == (o == order::recursive));
+        REQUIRE(S->number_of_rules() == T->number_of_rules());
+        REQUIRE(S->number_of_idempotents() == 1);
+        if (o == order::shortlex) {
+          // The elements are in the same order as the normal forms
+          std::vector<std::string> nfs(kb.cbegin_normal_forms(0, 10),
+                                       kb.cend_normal_forms());
+          for (size_t i = 0; i < S->size(); ++i) {
+            std::string w;
+            for (auto const& a : S->minimal_factorisation(i)) {
+              w += kb.alphabet()[a];
+            }
+            REQUIRE(w == nfs[i]);
+          }
+        }
+      }
+      {
+        KnuthBendix kb;
+        kb.set_alphabet("ab");
+        kb.add_rule("aaa", "a");
+        kb.add_rule("b", "aa");
+        kb.order(order::weighted_shortlex).weights({1, 3});
+        // The normal form of b is aa, so froidure_pin is used
+        REQUIRE(kb.froidure_pin_from_gilman_digraph() == kb.froidure_pin());
+      }
+      {
+        KnuthBendix kb;
+        REQUIRE_THROWS_AS(kb.froidure_pin_from_gilman_digraph(),
+                          LibsemigroupsException);
+        kb.set_alphabet("ab");
+        kb.add_rule("ab", "ba");
+        REQUIRE_THROWS_AS(kb.froidure_pin_from_gilman_digraph(),
+                          LibsemigroupsException);
+      }
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("KnuthBendix",
+                            "123",
+                            "(fpsemi) deferring overlaps and pruning",
+                            "[quick][knuth-bendix][fpsemigroup][fpsemi]") {
+      auto rg    = ReportGuard(REPORT);
+      auto setup = [](KnuthBendix& kb) {
+        kb.set_alphabet("aAbBe");
+        kb.set_identity("e");
+        kb.set_inverses("AaBbe");
+        kb.add_rule("bbb", "e");
+        kb.add_rule("ababab", "e");
+        kb.add_rule("aa", "e");
+      };
+      KnuthBendix kb1;
+      setup(kb1);
+      kb1.run();
+      REQUIRE(kb1.confluent());
+      REQUIRE(kb1.number_of_active_rules() == 19);
+      REQUIRE(kb1.size() == 12);
+
+      // The reduced confluent system is unique, and so deferring overlaps,
+      // or bounding the stack or the number of inactive rules, does not
+      // change the result.
+      for (size_t n = 1; n < 6; ++n) {
+        for (bool to_disk : {false, true}) {
+          for (size_t threads : {1, 2}) {
+            KnuthBendix kb2;
+            setup(kb2);
+            kb2.defer_overlap(n)
+                .defer_to_disk(to_disk)
+                .max_inactive_rules(0)
+                .max_stack_depth(n)
+                .max_threads(threads);
+            kb2.run();
+            REQUIRE(kb2.confluent());
+            REQUIRE(kb2.number_of_deferred_rules() == 0);
+            REQUIRE(kb2.active_rules() == kb1.active_rules());
+            REQUIRE(kb2.size() == 12);
+          }
+        }
+      }
+
+      // Deferred rules are kept when the run stops early, and are copied and
+      // saved.
+      KnuthBendix kb3;
+      setup(kb3);
+      kb3.defer_overlap(4).max_rules(18);
+      kb3.run();
+      REQUIRE(kb3.number_of_deferred_rules() == 1);
+      REQUIRE(!kb3.confluent());
+
+      KnuthBendix kb4(kb3);
+      REQUIRE(kb4.number_of_deferred_rules() == 1);
+      REQUIRE(!kb4.confluent());
+
+      std::stringstream ss;
+      kb3.save(ss);
+      KnuthBendix kb5;
+      kb5.load(ss);
+      REQUIRE(kb5.number_of_deferred_rules() == 1);
+      REQUIRE(kb5.active_rules() == kb3.active_rules());
+      REQUIRE(!kb5.confluent());
+
+      for (KnuthBendix* kb : {&kb3, &kb4, &kb5}) {
+        kb->max_rules(POSITIVE_INFINITY);
+        kb->run();
+        REQUIRE(kb->confluent());
+        REQUIRE(kb->number_of_deferred_rules() == 0);
+        REQUIRE(kb->active_rules() == kb1.active_rules());
+      }
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("KnuthBendix",
+                            "124",
+                            "(fpsemi) save and load mid-run resumes overlaps",
+                            "[quick][knuth-bendix][fpsemigroup][fpsemi]") {
+      auto rg    = ReportGuard(REPORT);
+      auto setup = [](KnuthBendix& kb) {
+        kb.set_alphabet("aAbBe");
+        kb.set_identity("e");
+        kb.set_inverses("AaBbe");
+        kb.add_rule("aaaa", "e");
+        kb.add_rule("bbb", "e");
+        kb.add_rule("abab", "e");
+        kb.check_confluence_interval(POSITIVE_INFINITY);
+      };
+      KnuthBendix kb1;
+      setup(kb1);
+      kb1.run();
+      REQUIRE(kb1.confluent());
+      size_t const total = kb1.number_of_overlaps();
+
+      KnuthBendix kb2;
+      setup(kb2);
+      kb2.max_rules(20);
+      kb2.run();
+      REQUIRE(!kb2.confluent());
+      size_t const before = kb2.number_of_overlaps();
+      REQUIRE(before > 0);
+      REQUIRE(before < total);
+
+      std::stringstream ss;
+      kb2.save(ss);
+      KnuthBendix kb3;
+      kb3.load(ss);
+      REQUIRE(kb3.number_of_overlaps() == 0);
+
+      // The overlaps considered before save are not considered again, neither
+      // by kb2 nor by kb3.
+      for (KnuthBendix* kb : {&kb2, &kb3}) {
+        kb->max_rules(POSITIVE_INFINITY);
+        kb->run();
+        REQUIRE(kb->confluent());
+        REQUIRE(kb->active_rules() == kb1.active_rules());
+      }
+      REQUIRE(kb2.number_of_overlaps() == total);
+      REQUIRE(kb3.number_of_overlaps() == total - before);
+    }
   }  // namespace fpsemigroup
 }  // namespace libsemigroups
@@ -16,6 +16,7 @@
 //
 
 #include <cstddef>  // for size_t
+#include <sstream>  // for stringstream
 
 #include "catch.hpp"      // for REQUIRE
 #include "test-main.hpp"  // FOR LIBSEMIGROUPS_TEST_CASE
@@ -286,4 +287,92 @@ namespace libsemigroups {
     Konieczny<BMat8> S(bmat4_gens);
     REQUIRE(S.size() == 65536);
   }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "049",
+                          "threads",
+                          "[quick][no-valgrind][bmat8]") {
+    auto                     rg = ReportGuard(REPORT);
+    std::vector<BMat8> const gens
+        = {BMat8({{0, 1, 0, 0}, {1, 0, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}),
+           BMat8({{0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}, {1, 0, 0, 0}}),
+           BMat8({{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {1, 0, 0, 1}}),
+           BMat8({{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 0}})};
+
+    // Every 4 x 4 boolean matrix
+    std::vector<BMat8> elts;
+    for (size_t i = 0; i < 65536; ++i) {
+      std::vector<std::vector<bool>> mat(4, std::vector<bool>(4, false));
+      for (size_t j = 0; j < 16; ++j) {
+        mat[j / 4][j % 4] = (i >> j) & 1;
+      }
+      elts.emplace_back(mat);
+    }
+
+    Konieczny<BMat8> S(gens);
+    REQUIRE(S.size() == 63904);
+    std::vector<bool> const mem = S.contains(elts.cbegin(), elts.cend());
+
+    for (size_t nr_threads : {2, 4}) {
+      Konieczny<BMat8> T(gens);
+      T.max_threads(nr_threads);
+      REQUIRE(T.size() == S.size());
+      REQUIRE(T.number_of_D_classes() == S.number_of_D_classes());
+      REQUIRE(T.number_of_regular_D_classes()
+              == S.number_of_regular_D_classes());
+      REQUIRE(T.number_of_L_classes() == S.number_of_L_classes());
+      REQUIRE(T.number_of_R_classes() == S.number_of_R_classes());
+      REQUIRE(T.number_of_idempotents() == S.number_of_idempotents());
+      REQUIRE(T.contains(elts.cbegin(), elts.cend()) == mem);
+      for (size_t i = 0; i < elts.size(); ++i) {
+        REQUIRE(T.contains(elts[i]) == mem[i]);
+      }
+    }
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "052",
+                          "save and load",
+                          "[quick][bmat8]") {
+    auto                     rg = ReportGuard(REPORT);
+    std::vector<BMat8> const gens
+        = {BMat8({{0, 1, 0, 0}, {1, 0, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}),
+           BMat8({{0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}, {1, 0, 0, 0}}),
+           BMat8({{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {1, 0, 0, 1}}),
+           BMat8({{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 0}})};
+    Konieczny<BMat8> S(gens);
+    S.run_until([&S]() -> bool { return S.current_number_of_D_classes() > 8; });
+    REQUIRE(!S.finished());
+    size_t const nr_D_classes = S.current_number_of_D_classes();
+
+    std::stringstream ss;
+    S.save(ss);
+    Konieczny<BMat8> T;
+    T.load(ss);
+    REQUIRE(T.number_of_generators() == gens.size());
+    REQUIRE(!T.finished());
+    REQUIRE(T.current_number_of_D_classes() == nr_D_classes);
+    REQUIRE(T.size() == 63904);
+    REQUIRE(T.number_of_D_classes() == S.number_of_D_classes());
+
+    ss.str("");
+    T.save(ss);
+    Konieczny<BMat8> U;
+    U.load(ss);
+    REQUIRE(U.size() == S.size());
+    REQUIRE(U.finished());
+    REQUIRE(U.number_of_D_classes() == S.number_of_D_classes());
+    REQUIRE(U.number_of_regular_D_classes() == S.number_of_regular_D_classes());
+    REQUIRE(U.number_of_L_classes() == S.number_of_L_classes());
+    REQUIRE(U.number_of_R_classes() == S.number_of_R_classes());
+    REQUIRE(U.number_of_idempotents() == S.number_of_idempotents());
+    for (size_t i = 0; i < 65536; i += 7) {
+      std::vector<std::vector<bool>> mat(4, std::vector<bool>(4, false));
+      for (size_t j = 0; j < 16; ++j) {
+        mat[j / 4][j % 4] = (i >> j) & 1;
+      }
+      BMat8 const x(mat);
+      REQUIRE(U.contains(x) == S.contains(x));
+    }
+  }
 }  // namespace libsemigroups
@@ -16,11 +16,15 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>  // for sort, unique
+#include <vector>     // for vector
+
 #include "catch.hpp"      // for REQUIRE
 #include "test-main.hpp"  // FOR LIBSEMIGROUPS_TEST_CASE
 
-#include "libsemigroups/konieczny.hpp"  // for Konieczny
-#include "libsemigroups/transf.hpp"     // for PPerm
+#include "libsemigroups/froidure-pin.hpp"  // for FroidurePin
+#include "libsemigroups/konieczny.hpp"     // for Konieczny
+#include "libsemigroups/transf.hpp"        // for PPerm
 
 namespace libsemigroups {
 
@@ -99,4 +103,95 @@ namespace libsemigroups {
     REQUIRE_THROWS_AS(S.add_generators(gens.begin(), gens.begin() + 2),
                       LibsemigroupsException);
   }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "047",
+                          "partial perm - stabilizer chains for H-classes",
+                          "[quick][pperm][no-valgrind]") {
+    auto                             rg = ReportGuard(REPORT);
+    std::vector<LeastPPerm<9>> const gens
+        = {LeastPPerm<9>({0, 2, 3, 7}, {1, 6, 7, 3}, 9),
+           LeastPPerm<9>({0, 1, 2, 3, 4, 7}, {6, 5, 8, 0, 2, 1}, 9),
+           LeastPPerm<9>({0, 1, 2, 3, 4, 5, 6, 8}, {1, 7, 2, 6, 0, 4, 8, 5}, 9),
+           LeastPPerm<9>({0, 1, 2, 3, 5, 6, 8}, {2, 4, 6, 1, 5, 8, 7}, 9),
+           LeastPPerm<9>({0, 1, 2, 3, 5, 8}, {7, 3, 6, 4, 2, 5}, 9)};
+    Konieczny<LeastPPerm<9>> S(gens);
+    S.use_schreier_sims(true);
+    for (auto x : gens) {
+      REQUIRE(S.contains(x));
+      REQUIRE(S.D_class_of_element(x).contains(x));
+    }
+    REQUIRE(!S.contains(
+        LeastPPerm<9>({0, 1, 2, 3, 4, 5, 6, 7}, {1, 7, 2, 6, 0, 4, 8, 5}, 9)));
+    REQUIRE(!S.contains(
+        LeastPPerm<9>({0, 1, 2, 3, 4, 5, 6, 7}, {0, 1, 2, 3, 4, 5, 6, 8}, 9)));
+    REQUIRE(S.size() == 21033);
+    REQUIRE(S.number_of_D_classes() == 3242);
+
+    Konieczny<LeastPPerm<8>> T(
+        {LeastPPerm<8>({0, 1, 2, 3, 4, 5, 6, 7}, {0, 1, 2, 3, 4, 5, 6, 7}, 8),
+         LeastPPerm<8>({0, 1, 2, 3, 4, 5, 6, 7}, {1, 2, 3, 4, 5, 6, 7, 0}, 8),
+         LeastPPerm<8>({0, 1, 2, 3, 4, 5, 6, 7}, {1, 0, 2, 3, 4, 5, 6, 7}, 8),
+         LeastPPerm<8>({1, 2, 3, 4, 5, 6, 7}, {0, 1, 2, 3, 4, 5, 6}, 8),
+         LeastPPerm<8>({0, 1, 2, 3, 4, 5, 6}, {1, 2, 3, 4, 5, 6, 7}, 8)});
+    T.use_schreier_sims(true);
+    REQUIRE(T.size() == 1441729);
+    REQUIRE(T.number_of_D_classes() == 9);
+    REQUIRE(T.number_of_idempotents() == 256);
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "050",
+                          "partial perm - threads",
+                          "[quick][pperm][no-valgrind]") {
+    auto                             rg = ReportGuard(REPORT);
+    std::vector<LeastPPerm<9>> const gens
+        = {LeastPPerm<9>({0, 2, 3, 7}, {1, 6, 7, 3}, 9),
+           LeastPPerm<9>({0, 1, 2, 3, 4, 7}, {6, 5, 8, 0, 2, 1}, 9),
+           LeastPPerm<9>({0, 1, 2, 3, 4, 5, 6, 8}, {1, 7, 2, 6, 0, 4, 8, 5}, 9),
+           LeastPPerm<9>({0, 1, 2, 3, 5, 6, 8}, {2, 4, 6, 1, 5, 8, 7}, 9),
+           LeastPPerm<9>({0, 1, 2, 3, 5, 8}, {7, 3, 6, 4, 2, 5}, 9)};
+
+    // The elements of S, and some partial perms that are not in S
+    FroidurePin<LeastPPerm<9>> F(gens);
+    F.run();
+    std::vector<LeastPPerm<9>> elts(F.cbegin(), F.cend());
+    REQUIRE(elts.size() == 21033);
+    for (size_t i = 0; i < 9; ++i) {
+      std::vector<LeastPPerm<9>::value_type> dom, ran;
+      for (size_t j = 0; j < 9; ++j) {
+        if (j != i) {
+          dom.push_back(j);
+          ran.push_back((j * (i + 2) + 1) % 9);
+        }
+      }
+      std::sort(ran.begin(), ran.end());
+      ran.erase(std::unique(ran.begin(), ran.end()), ran.end());
+      dom.resize(ran.size());
+      elts.push_back(LeastPPerm<9>(dom, ran, 9));
+    }
+
+    Konieczny<LeastPPerm<9>> S(gens);
+    REQUIRE(S.size() == 21033);
+    std::vector<bool> const mem = S.contains(elts.cbegin(), elts.cend());
+    for (size_t i = 0; i < elts.size(); ++i) {
+      REQUIRE(mem[i] == F.contains(elts[i]));
+    }
+
+    for (size_t nr_threads : {2, 4}) {
+      Konieczny<LeastPPerm<9>> T(gens);
+      T.max_threads(nr_threads);
+      REQUIRE(T.size() == S.size());
+      REQUIRE(T.number_of_D_classes() == 3242);
+      REQUIRE(T.number_of_regular_D_classes()
+              == S.number_of_regular_D_classes());
+      REQUIRE(T.number_of_L_classes() == S.number_of_L_classes());
+      REQUIRE(T.number_of_R_classes() == S.number_of_R_classes());
+      REQUIRE(T.number_of_idempotents() == S.number_of_idempotents());
+      REQUIRE(T.contains(elts.cbegin(), elts.cend()) == mem);
+      for (size_t i = 0; i < elts.size(); ++i) {
+        REQUIRE(T.contains(elts[i]) == mem[i]);
+      }
+    }
+  }
 }  // namespace libsemigroups
@@ -16,13 +16,20 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-#include <cstddef>  // for size_t
+#include <algorithm>      // for count
+#include <atomic>         // for atomic
+#include <cstddef>        // for size_t
+#include <iterator>       // for distance
+#include <sstream>        // for stringstream
+#include <thread>         // for this_thread
+#include <unordered_set>  // for unordered_set
 
-#include "catch.hpp"      // for REQUIRE
+#include "catch.hpp"      // for REQUIRE, REQUIRE_THROWS_AS
 #include "test-main.hpp"  // FOR LIBSEMIGROUPS_TEST_CASE
 
-#include "libsemigroups/konieczny.hpp"  // for Konieczny
-#include "libsemigroups/transf.hpp"     // for Transf<>
+#include "libsemigroups/froidure-pin.hpp"  // for FroidurePin
+#include "libsemigroups/konieczny.hpp"     // for Konieczny
+#include "libsemigroups/transf.hpp"        // for Transf<>
 
 namespace libsemigroups {
 
@@ -255,4 +262,355 @@ namespace libsemigroups {
                 0, 0, 0, 16, 2, 10, 2, 26, 1, 1, 5, 21, 3, 11, 7}));
     REQUIRE(K.size() == 23191071);
   }
+
+  namespace {
+    // The generators of JDM's favourite example, a semigroup of size 597369
+    // with 257 D-classes.
+    std::vector<LeastTransf<8>> const& jdm_favourite_gens() {
+      using Transf = LeastTransf<8>;
+      static std::vector<Transf> const gens
+          = {Transf({1, 7, 2, 6, 0, 4, 1, 5}),
+             Transf({2, 4, 6, 1, 4, 5, 2, 7}),
+             Transf({3, 0, 7, 2, 4, 6, 2, 4}),
+             Transf({3, 2, 3, 4, 5, 3, 0, 1}),
+             Transf({4, 3, 7, 7, 4, 5, 0, 4}),
+             Transf({5, 6, 3, 0, 3, 0, 5, 1}),
+             Transf({6, 0, 1, 1, 1, 6, 3, 4}),
+             Transf({7, 7, 4, 0, 6, 4, 1, 7})};
+      return gens;
+    }
+
+    // Checks S, which is generated by jdm_favourite_gens(), against a
+    // Konieczny instance using the default settings.
+    void check_jdm_favourite(Konieczny<LeastTransf<8>>& S) {
+      Konieczny<LeastTransf<8>> T(jdm_favourite_gens());
+      REQUIRE(S.size() == 597369);
+      REQUIRE(S.number_of_D_classes() == 257);
+      REQUIRE(S.number_of_idempotents() == 8194);
+      REQUIRE(T.size() == 597369);
+      REQUIRE(S.number_of_regular_D_classes()
+              == T.number_of_regular_D_classes());
+      REQUIRE(S.number_of_L_classes() == T.number_of_L_classes());
+      REQUIRE(S.number_of_R_classes() == T.number_of_R_classes());
+      REQUIRE(S.number_of_regular_elements() == T.number_of_regular_elements());
+      for (auto it = T.cbegin_D_classes(); it < T.cend_D_classes(); ++it) {
+        REQUIRE(S.D_class_of_element(it->rep()).size() == it->size());
+      }
+      for (auto const& x : jdm_favourite_gens()) {
+        REQUIRE(S.contains(x));
+      }
+    }
+
+    // The generators of a semigroup of transformations of degree 5, which
+    // does not contain every transformation of degree 5.
+    template <typename Transf>
+    std::vector<Transf> degree_5_gens() {
+      return {Transf({1, 2, 2, 4, 3}),
+              Transf({0, 0, 2, 4, 1}),
+              Transf({3, 3, 0, 1, 2})};
+    }
+
+    // Every transformation of degree 5 except the identity, which is adjoined
+    // by Konieczny but does not belong to the semigroup generated by
+    // degree_5_gens().
+    template <typename Transf>
+    std::vector<Transf> degree_5_elements() {
+      std::vector<Transf> elts;
+      for (size_t i = 0; i < 3125; ++i) {
+        Transf x({0, 0, 0, 0, 0});
+        for (size_t j = 0, k = i; j < 5; ++j, k /= 5) {
+          x[j] = k % 5;
+        }
+        if (x != Transf::identity(5)) {
+          elts.push_back(x);
+        }
+      }
+      return elts;
+    }
+  }  // namespace
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "040",
+                          "transformations - JDM favourite example threads",
+                          "[quick][no-valgrind][transf]") {
+    auto                      rg = ReportGuard(REPORT);
+    Konieczny<LeastTransf<8>> S(jdm_favourite_gens());
+    REQUIRE(S.max_threads() == 1);
+    S.max_threads(0);
+    REQUIRE(S.max_threads() == 1);
+    S.max_threads(4);
+    REQUIRE(S.max_threads() == 4);
+    check_jdm_favourite(S);
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "041",
+                          "transformations - threads and run_until",
+                          "[quick][no-valgrind][transf]") {
+    auto                      rg = ReportGuard(REPORT);
+    Konieczny<LeastTransf<8>> S(jdm_favourite_gens());
+    S.max_threads(2);
+    std::atomic<size_t> nr_calls(0);
+    S.run_until([&nr_calls]() -> bool { return ++nr_calls > 2; });
+    REQUIRE(!S.finished());
+    check_jdm_favourite(S);
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "042",
+                          "transformations - contains all of degree 5",
+                          "[quick][transf]") {
+    using Transf            = LeastTransf<5>;
+    auto                rg  = ReportGuard(REPORT);
+    Konieczny<Transf>   S(degree_5_gens<Transf>());
+    FroidurePin<Transf> T(degree_5_gens<Transf>());
+    T.run();
+    REQUIRE(S.size() == T.size());
+
+    size_t nr_regular = 0;
+    for (auto const& x : degree_5_elements<Transf>()) {
+      REQUIRE(S.contains(x) == T.contains(x));
+      if (T.contains(x)) {
+        REQUIRE(S.D_class_of_element(x).contains(x));
+        nr_regular += S.is_regular_element(x);
+      }
+    }
+    REQUIRE(nr_regular == S.number_of_regular_elements());
+    REQUIRE(nr_regular < S.size());
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "043",
+                          "transformations - batch contains/is_regular_element",
+                          "[quick][transf]") {
+    using Transf                   = LeastTransf<5>;
+    auto                      rg   = ReportGuard(REPORT);
+    std::vector<Transf> const elts = degree_5_elements<Transf>();
+
+    for (size_t nr_threads : {1, 2, 4}) {
+      Konieczny<Transf> S(degree_5_gens<Transf>());
+      S.max_threads(nr_threads);
+      std::vector<bool> mem = S.contains(elts.cbegin(), elts.cend());
+      std::vector<bool> reg
+          = S.is_regular_element(elts.cbegin(), elts.cend());
+      REQUIRE(mem.size() == elts.size());
+      REQUIRE(reg.size() == elts.size());
+      REQUIRE(size_t(std::count(mem.cbegin(), mem.cend(), true))
+              == S.size());
+      REQUIRE(size_t(std::count(reg.cbegin(), reg.cend(), true))
+              == S.number_of_regular_elements());
+      for (size_t i = 0; i < elts.size(); ++i) {
+        REQUIRE(mem[i] == S.contains(elts[i]));
+        REQUIRE(reg[i] == S.is_regular_element(elts[i]));
+      }
+      REQUIRE(S.contains(elts.cbegin(), elts.cbegin()).empty());
+    }
+
+    // If the enumeration cannot finish, the elements cannot be tested.
+    Konieczny<Transf> S(degree_5_gens<Transf>());
+    S.run_until(
+        [&S]() -> bool { return S.current_number_of_D_classes() > 0; });
+    S.kill();
+    REQUIRE(!S.finished());
+    REQUIRE_THROWS_AS(S.contains(elts.cbegin(), elts.cend()),
+                      LibsemigroupsException);
+    REQUIRE_THROWS_AS(S.is_regular_element(elts.cbegin(), elts.cend()),
+                      LibsemigroupsException);
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "044",
+                          "transformations - D-class element iterators",
+                          "[quick][transf]") {
+    auto                  rg = ReportGuard(REPORT);
+    Konieczny<Transf<>>   S(degree_5_gens<Transf<>>());
+    FroidurePin<Transf<>> T(degree_5_gens<Transf<>>());
+    S.run();
+
+    std::unordered_set<Transf<>, Hash<Transf<>>> all;
+    for (auto it = S.cbegin_D_classes(); it < S.cend_D_classes(); ++it) {
+      std::unordered_set<Transf<>, Hash<Transf<>>> elts(
+          it->cbegin_elements(), it->cend_elements());
+      REQUIRE(elts.size() == it->size());
+      REQUIRE(size_t(std::distance(it->cbegin_elements(),
+                                   it->cend_elements()))
+              == it->size());
+      for (auto const& x : elts) {
+        REQUIRE(S.D_class_of_element(x).contains(it->rep()));
+      }
+      all.insert(elts.cbegin(), elts.cend());
+    }
+    // the adjoined identity is not in T
+    all.erase(Transf<>::identity(5));
+    REQUIRE(all.size() == S.size());
+    REQUIRE(all.size() == T.size());
+    for (auto const& x : all) {
+      REQUIRE(T.contains(x));
+    }
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "045",
+                          "transformations - save and load",
+                          "[quick][no-valgrind][transf]") {
+    using Transf                   = LeastTransf<8>;
+    auto                      rg   = ReportGuard(REPORT);
+    std::vector<Transf> const gens = jdm_favourite_gens();
+    Konieczny<Transf>         S(gens);
+    size_t                    nr_calls = 0;
+    S.run_until([&nr_calls]() -> bool { return ++nr_calls > 8; });
+    REQUIRE(!S.finished());
+    size_t const nr_D_classes = S.current_number_of_D_classes();
+    REQUIRE(nr_D_classes > 1);
+
+    std::stringstream ss;
+    S.save(ss);
+    Konieczny<Transf> T;
+    T.load(ss);
+    REQUIRE(T.number_of_generators() == gens.size());
+    REQUIRE(!T.finished());
+    REQUIRE(T.current_number_of_D_classes() == nr_D_classes);
+    check_jdm_favourite(T);
+
+    ss.str("");
+    T.save(ss);
+    Konieczny<Transf> U;
+    U.load(ss);
+    REQUIRE(U.current_number_of_D_classes() == 257);
+    check_jdm_favourite(U);
+    REQUIRE(U.finished());
+
+    ss.str("");
+    Konieczny<Transf> V(gens);
+    V.save(ss);
+    Konieczny<Transf> W;
+    W.load(ss);
+    REQUIRE(W.number_of_generators() == gens.size());
+    REQUIRE(W.size() == 597369);
+
+    ss.str("");
+    S.save(ss);
+    REQUIRE_THROWS_AS(U.load(ss), LibsemigroupsException);
+    Konieczny<Transf> X;
+    std::stringstream bad("not the output of Konieczny::save");
+    REQUIRE_THROWS_AS(X.load(bad), LibsemigroupsException);
+    Konieczny<Transf> Y;
+    std::string       str = ss.str();
+    std::stringstream truncated(str.substr(0, str.size() / 2));
+    REQUIRE_THROWS_AS(Y.load(truncated), LibsemigroupsException);
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "046",
+                          "transformations - stabilizer chains for H-classes",
+                          "[quick][no-valgrind][transf]") {
+    using Transf          = LeastTransf<8>;
+    auto              rg  = ReportGuard(REPORT);
+    Konieczny<Transf> S(jdm_favourite_gens());
+    REQUIRE(!S.use_schreier_sims());
+    S.use_schreier_sims(true);
+    REQUIRE(S.use_schreier_sims());
+    check_jdm_favourite(S);
+    REQUIRE_THROWS_AS(S.use_schreier_sims(false), LibsemigroupsException);
+
+    Konieczny<Transf> T(jdm_favourite_gens());
+    for (auto it = T.cbegin_D_classes(); it < T.cend_D_classes(); ++it) {
+      REQUIRE(S.D_class_of_element(it->rep()).size_H_class()
+              == it->size_H_class());
+    }
+
+    std::vector<Transf> elts;
+    Transf              x({0, 0, 0, 0, 0, 0, 0, 0});
+    for (size_t i = 0; i < 8000; ++i) {
+      for (size_t j = 0, k = 37 * i; j < 8; ++j, k /= 3) {
+        x[j] = (k + 5 * j * i) % 8;
+      }
+      if (x != Transf::identity(8)) {
+        elts.push_back(x);
+      }
+    }
+    S.max_threads(2);
+    REQUIRE(S.contains(elts.cbegin(), elts.cend())
+            == T.contains(elts.cbegin(), elts.cend()));
+
+    // Listing the H-classes, which happens on demand
+    for (auto it = S.cbegin_D_classes(); it < S.cend_D_classes(); ++it) {
+      REQUIRE(size_t(std::distance(it->cbegin_elements(),
+                                   it->cend_elements()))
+              == it->size());
+    }
+
+    // Full transformation monoid of degree 8
+    Konieczny<Transf> U({Transf({1, 0, 2, 3, 4, 5, 6, 7}),
+                         Transf({1, 2, 3, 4, 5, 6, 7, 0}),
+                         Transf({0, 0, 2, 3, 4, 5, 6, 7})});
+    U.use_schreier_sims(true);
+    REQUIRE(U.size() == 16777216);
+    REQUIRE(U.number_of_D_classes() == 8);
+    REQUIRE(U.D_class_of_element(Transf::identity(8)).size_H_class() == 40320);
+
+    Konieczny<libsemigroups::Transf<>> V;
+    REQUIRE_THROWS_AS(V.use_schreier_sims(true), LibsemigroupsException);
+    REQUIRE_NOTHROW(V.use_schreier_sims(false));
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "048",
+                          "transformations - frames of dynamic degree",
+                          "[quick][transf]") {
+    auto                rg = ReportGuard(REPORT);
+    Konieczny<Transf<>> S({Transf<>({1, 0, 2, 3}),
+                           Transf<>({1, 2, 3, 0}),
+                           Transf<>({0, 0, 2, 3})});
+    REQUIRE(S.size() == 256);
+    REQUIRE(S.number_of_D_classes() == 4);
+
+    // In the full transformation monoid of degree 4, the D-class of rank k
+    // has binomial(4, k) L-classes, Stirling2(4, k) R-classes, H-classes of
+    // size k!, and binomial(4, k) * k ^ (4 - k) idempotents.
+    std::vector<size_t> const nr_L    = {4, 6, 4, 1};
+    std::vector<size_t> const nr_R    = {1, 7, 6, 1};
+    std::vector<size_t> const size_H  = {1, 2, 6, 24};
+    std::vector<size_t> const nr_idem = {4, 24, 12, 1};
+
+    for (auto it = S.cbegin_D_classes(); it < S.cend_D_classes(); ++it) {
+      size_t const k = it->rep().rank() - 1;
+      REQUIRE(it->number_of_L_classes() == nr_L[k]);
+      REQUIRE(it->number_of_R_classes() == nr_R[k]);
+      REQUIRE(it->size_H_class() == size_H[k]);
+      REQUIRE(it->number_of_idempotents() == nr_idem[k]);
+      REQUIRE(it->size() == nr_L[k] * nr_R[k] * size_H[k]);
+
+      // Every element computed from the frame has the correct degree and
+      // rank, and they are distinct, so the D-class has the correct elements.
+      std::unordered_set<Transf<>, Hash<Transf<>>> elts;
+      for (auto e = it->cbegin_elements(); e != it->cend_elements(); ++e) {
+        REQUIRE(e->degree() == 4);
+        REQUIRE(e->rank() == k + 1);
+        elts.insert(*e);
+      }
+      REQUIRE(elts.size() == it->size());
+    }
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "051",
+                          "transformations - exception in the rho orbit",
+                          "[quick][no-valgrind][transf]") {
+    auto                      rg = ReportGuard(REPORT);
+    Konieczny<LeastTransf<8>> S(jdm_favourite_gens());
+    S.max_threads(2);
+    // The predicate is called from the thread running the rho orbit, where
+    // it throws, and the exception must be rethrown in this thread.
+    auto const id = std::this_thread::get_id();
+    REQUIRE_THROWS_AS(S.run_until([&id]() -> bool {
+      if (std::this_thread::get_id() != id) {
+        LIBSEMIGROUPS_EXCEPTION("called from another thread");
+      }
+      return false;
+    }),
+                      LibsemigroupsException);
+    REQUIRE(!S.finished());
+    check_jdm_favourite(S);
+  }
 }  // namespace libsemigroups
@@ -3074,4 +3074,27 @@ namespace libsemigroups {
     }
     REQUIRE_THROWS_AS(S.add_base_point(6), LibsemigroupsException);
   }
+
+  LIBSEMIGROUPS_TEST_CASE("SchreierSims",
+                          "042",
+                          "add generators after computing size",
+                          "[quick][schreier-sims]") {
+    auto            rg = ReportGuard(REPORT);
+    SchreierSims<8> S;
+    using Perm = typename decltype(S)::element_type;
+    S.add_generator(Perm({0, 2, 1, 3, 4, 5, 6, 7}));
+    REQUIRE(S.size() == 2);
+    S.add_generator(Perm({0, 1, 3, 2, 4, 5, 6, 7}));
+    REQUIRE(S.size() == 6);
+    S.add_generator(Perm({0, 1, 2, 4, 3, 5, 6, 7}));
+    REQUIRE(S.size() == 24);
+    S.add_generator(Perm({0, 1, 2, 3, 5, 4, 6, 7}));
+    REQUIRE(S.size() == 120);
+    S.add_generator(Perm({0, 1, 2, 3, 4, 6, 5, 7}));
+    REQUIRE(S.size() == 720);
+    S.add_generator(Perm({1, 2, 3, 4, 5, 6, 0, 7}));
+    REQUIRE(S.size() == 5040);
+    REQUIRE(S.contains(Perm({6, 0, 1, 2, 3, 4, 5, 7})));
+    REQUIRE(!S.contains(Perm({0, 1, 2, 3, 4, 5, 7, 6})));
+  }
 }  // namespace libsemigroups
@@ -3523,5 +3523,295 @@ namespace libsemigroups {
       REQUIRE_THROWS_AS(tc.congruence().sort_generating_pairs(shortlex_compare),
                         LibsemigroupsException);
     }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "099",
+                            "large collapse",
+                            "[todd-coxeter][quick]") {
+      auto rg = ReportGuard(REPORT);
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet("abABe");
+        tc.set_identity("e");
+        tc.set_inverses("ABabe");
+        tc.add_rule("aa", "e");
+        tc.add_rule("bbb", "e");
+        tc.add_rule("ababababab", "e");
+        tc.congruence().large_collapse(0);
+        REQUIRE(tc.congruence().large_collapse() == 0);
+
+        TEST_HLT(tc.congruence());
+        TEST_FELSCH(tc.congruence());
+        TEST_RANDOM_SIMS(tc.congruence());
+
+        REQUIRE(tc.size() == 60);
+      }
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet("ab");
+        tc.add_rule("aa", "bb");
+        tc.add_rule("ba", "aaaaaab");
+        tc.congruence().large_collapse(0).next_lookahead(1);
+
+        TEST_HLT(tc.congruence());
+        TEST_FELSCH(tc.congruence());
+
+        REQUIRE(tc.size() == 14);
+        REQUIRE(tc.congruence().complete());
+        REQUIRE(tc.congruence().compatible());
+        REQUIRE(tc.normal_form("aaaaaaab") == "aab");
+        REQUIRE(tc.normal_form("bab") == "aaa");
+      }
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet("eab");
+        tc.set_identity("e");
+        size_t const N = 200;
+        tc.add_rule("a" + std::string(N, 'b'), "e");
+        tc.add_rule(std::string(N, 'a'), std::string(N + 1, 'b'));
+        tc.add_rule("ba", std::string(N, 'b') + "a");
+        tc.congruence().large_collapse(1000);
+        REQUIRE(tc.size() == 1);
+      }
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "100",
+                            "concurrent standardization",
+                            "[todd-coxeter][quick]") {
+      auto        rg = ReportGuard(REPORT);
+      ToddCoxeter tc1;
+      tc1.set_alphabet("abABe");
+      tc1.set_identity("e");
+      tc1.set_inverses("ABabe");
+      tc1.add_rule("aa", "e");
+      tc1.add_rule("bbb", "e");
+      tc1.add_rule("ababababab", "e");
+      REQUIRE(tc1.size() == 60);
+
+      ToddCoxeter tc2(tc1);
+      tc2.congruence().max_threads(4).concurrency_threshold(0);
+      REQUIRE(tc2.congruence().concurrency_threshold() == 0);
+      REQUIRE(tc2.congruence().max_threads() == 4);
+      REQUIRE(ToddCoxeter(tc1).congruence().max_threads(0).max_threads() == 1);
+
+      for (auto rdr :
+           {tc_order::shortlex, tc_order::lex, tc_order::recursive}) {
+        tc1.congruence().standardize(rdr);
+        tc2.congruence().standardize(rdr);
+        REQUIRE(std::vector<word_type>(tc1.congruence().cbegin_normal_forms(),
+                                       tc1.congruence().cend_normal_forms())
+                == std::vector<word_type>(
+                    tc2.congruence().cbegin_normal_forms(),
+                    tc2.congruence().cend_normal_forms()));
+        REQUIRE(tc2.congruence().complete());
+        REQUIRE(tc2.congruence().compatible());
+      }
+      REQUIRE(std::is_sorted(tc2.congruence().cbegin_normal_forms(),
+                             tc2.congruence().cend_normal_forms(),
+                             RecursivePathCompare<word_type>{}));
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "101",
+                            "adaptive strategy",
+                            "[no-valgrind][todd-coxeter][quick]") {
+      auto rg = ReportGuard(REPORT);
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet("abABe");
+        tc.set_identity("e");
+        tc.set_inverses("ABabe");
+        tc.add_rule("aa", "e");
+        tc.add_rule("bbb", "e");
+        tc.add_rule("ababababab", "e");
+        tc.congruence()
+            .strategy(options::strategy::adaptive)
+            .random_interval(std::chrono::milliseconds(10))
+            .lookahead(options::lookahead::full)
+            .next_lookahead(123);
+        REQUIRE(tc.size() == 60);
+        REQUIRE(tc.congruence().strategy() == options::strategy::adaptive);
+        REQUIRE(tc.congruence().lookahead() == options::lookahead::full);
+        REQUIRE(tc.congruence().next_lookahead() == 123);
+        REQUIRE(!tc.congruence().save());
+      }
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet(5);
+        for (relation_type const& rl : RookMonoid(4, 0)) {
+          tc.add_rule(rl);
+        }
+        tc.congruence()
+            .strategy(options::strategy::adaptive)
+            .random_interval(std::chrono::milliseconds(1));
+        REQUIRE(tc.size() == 209);
+        REQUIRE(tc.congruence().complete());
+        REQUIRE(tc.congruence().compatible());
+      }
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet(11);
+        for (relation_type const& rl : RennerTypeDMonoid(4, 1)) {
+          tc.add_rule(rl);
+        }
+        tc.congruence()
+            .strategy(options::strategy::adaptive)
+            .random_interval(std::chrono::milliseconds(5));
+        REQUIRE(tc.size() == 10625);
+        REQUIRE(tc.congruence().complete());
+        REQUIRE(tc.congruence().compatible());
+      }
+      {
+        // Felsch is not permitted here
+        using Transf = LeastTransf<5>;
+        FroidurePin<Transf> S(
+            {Transf({1, 3, 4, 2, 3}), Transf({3, 2, 1, 3, 3})});
+        congruence::ToddCoxeter tc(twosided, S);
+        tc.strategy(options::strategy::adaptive)
+            .random_interval(std::chrono::milliseconds(1));
+        tc.add_pair({0}, {1, 1});
+        REQUIRE(tc.number_of_classes() == 1);
+      }
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "102",
+                            "HLT without preimages",
+                            "[no-valgrind][todd-coxeter][quick]") {
+      auto rg = ReportGuard(REPORT);
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet("abABe");
+        tc.set_identity("e");
+        tc.set_inverses("ABabe");
+        tc.add_rule("aa", "e");
+        tc.add_rule("bbb", "e");
+        tc.add_rule("ababababab", "e");
+        tc.congruence().store_preimages(false);
+        SECTION("partial lookahead") {
+          tc.congruence().lookahead(options::lookahead::partial);
+        }
+        SECTION("full lookahead") {
+          tc.congruence().lookahead(options::lookahead::full).next_lookahead(
+              10);
+        }
+        REQUIRE(!tc.congruence().store_preimages());
+        REQUIRE(tc.size() == 60);
+        REQUIRE(tc.congruence().complete());
+        REQUIRE(tc.congruence().compatible());
+        REQUIRE(tc.normal_form("ABABABABAB") == "e");
+      }
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet(11);
+        for (relation_type const& rl : RennerTypeDMonoid(4, 1)) {
+          tc.add_rule(rl);
+        }
+        tc.congruence().store_preimages(false).next_lookahead(2000);
+        tc.run_for(std::chrono::milliseconds(5));
+        REQUIRE(tc.size() == 10625);
+        REQUIRE(tc.congruence().complete());
+        REQUIRE(tc.congruence().compatible());
+        // Preimages are restored once the enumeration stops
+        tc.congruence().standardize(tc_order::lex);
+        REQUIRE(tc.congruence().is_standardized());
+      }
+      {
+        ToddCoxeter tc;
+        tc.set_alphabet("abABe");
+        tc.set_identity("e");
+        tc.set_inverses("ABabe");
+        tc.add_rule("aa", "e");
+        tc.add_rule("bbb", "e");
+        tc.add_rule("ababababab", "e");
+        tc.congruence()
+            .store_preimages(false)
+            .strategy(options::strategy::felsch);
+        REQUIRE_THROWS_AS(tc.size(), LibsemigroupsException);
+        tc.congruence().strategy(options::strategy::hlt).save(true);
+        REQUIRE_THROWS_AS(tc.size(), LibsemigroupsException);
+        tc.congruence().save(false).standardize(true);
+        REQUIRE_THROWS_AS(tc.size(), LibsemigroupsException);
+        tc.congruence().standardize(false);
+        REQUIRE(tc.size() == 60);
+      }
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "103",
+                            "many congruences sharing a Cayley graph",
+                            "[todd-coxeter][quick]") {
+      auto rg      = ReportGuard(REPORT);
+      using Transf = LeastTransf<5>;
+      auto S       = std::make_shared<FroidurePin<Transf>>(
+          std::initializer_list<Transf>(
+              {Transf({1, 3, 4, 2, 3}), Transf({3, 2, 1, 3, 3})}));
+      REQUIRE(S->size() == 88);
+      auto const graph = S->right_cayley_graph();
+
+      std::vector<std::unique_ptr<congruence::ToddCoxeter>> tcs;
+      for (size_t i = 0; i < 8; ++i) {
+        tcs.push_back(std::make_unique<congruence::ToddCoxeter>(
+            twosided, S, options::froidure_pin::use_cayley_graph));
+        tcs.back()->store_preimages(i % 2 == 0);
+      }
+      tcs[0]->add_pair(S->factorisation(Transf({3, 4, 4, 4, 4})),
+                       S->factorisation(Transf({3, 1, 3, 3, 3})));
+      tcs[1]->add_pair(S->factorisation(Transf({3, 4, 4, 4, 4})),
+                       S->factorisation(Transf({3, 1, 3, 3, 3})));
+      tcs[2]->add_pair({0}, {1, 1});
+      tcs[3]->add_pair({0}, {1, 1});
+      REQUIRE(tcs[0]->number_of_classes() == 21);
+      REQUIRE(tcs[1]->number_of_classes() == 21);
+      REQUIRE(tcs[2]->number_of_classes() == 1);
+      REQUIRE(tcs[3]->number_of_classes() == 1);
+      for (size_t i = 4; i < 8; ++i) {
+        REQUIRE(tcs[i]->number_of_classes() == 88);
+        REQUIRE(tcs[i]->contains({0, 1}, {0, 1}));
+        REQUIRE(!tcs[i]->contains({0}, {1}));
+      }
+      // The Cayley graph of S is not modified
+      REQUIRE(S->right_cayley_graph() == graph);
+
+      REQUIRE(tcs[1]->quotient_froidure_pin()->size() == 21);
+      REQUIRE(tcs[4]->quotient_froidure_pin()->size() == 88);
+      REQUIRE(S->right_cayley_graph() == graph);
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "104",
+                            "standardizing does not copy borrowed rows",
+                            "[todd-coxeter][quick]") {
+      auto rg      = ReportGuard(REPORT);
+      using Transf = LeastTransf<5>;
+      auto S       = std::make_shared<FroidurePin<Transf>>(
+          std::initializer_list<Transf>(
+              {Transf({1, 3, 4, 2, 3}), Transf({3, 2, 1, 3, 3})}));
+      REQUIRE(S->size() == 88);
+
+      for (auto knd : {left, right, twosided}) {
+        for (bool val : {true, false}) {
+          congruence::ToddCoxeter tc(
+              knd, S, options::froidure_pin::use_cayley_graph);
+          tc.store_preimages(val);
+          REQUIRE(tc.contains({0, 1}, {0, 1}));
+          REQUIRE(!tc.contains({0}, {1}));
+          REQUIRE(tc.number_of_classes() == 88);
+          REQUIRE(tc.number_of_borrowed_rows() == 88);
+
+          std::vector<bool> seen(88, false);
+          for (size_t i = 0; i < S->size(); ++i) {
+            size_t const c = tc.word_to_class_index(S->factorisation(i));
+            REQUIRE(c < 88);
+            REQUIRE(!seen[c]);
+            seen[c] = true;
+            REQUIRE(tc.word_to_class_index(tc.class_index_to_word(c)) == c);
+          }
+          REQUIRE(tc.is_standardized());
+          REQUIRE(tc.number_of_borrowed_rows() == 88);
+        }
+      }
+    }
   }  // namespace fpsemigroup
 }  // namespace libsemigroups